@@ -0,0 +1,103 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Checkpoint.cc
+///
+
+// Latency of the checkpoint hot write path: a pid bank snapshot rebuilt and
+// written into the memory mapped state file at every save, without a flush
+// (the per-cycle path) and with a flush to the storage device (sync). Flushed
+// saves depend on the storage device, so fewer of them are timed.
+// Build:
+//   g++ -std=c++20 -O2 -I src benchmarks/Checkpoint.cc
+// Usage: Checkpoint [saves] [state file path]
+
+#include "Piddle.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace Piddle;
+
+//! Time a number of saves and print the latency percentiles (microseconds)
+static void
+time_saves(
+  Checkpoint & checkpoint, //!< Checkpoint to save
+  PIDBank &    bank,       //!< Saved pid bank, stepped between the saves
+  integer      saves,      //!< Number of timed saves
+  bool         sync,       //!< Flush the snapshots
+  char const * label       //!< Row label
+)
+{
+  std::vector<real>   errors(std::size_t(bank.size()), 0.3), out(std::size_t(bank.size()));
+  std::vector<double> latency(saves);
+  for (integer k = 0; k < saves; ++k)
+  {
+    bank.setup(errors, 1.0e-3, out);
+    auto start = std::chrono::steady_clock::now();
+    checkpoint.save(sync);
+    auto stop = std::chrono::steady_clock::now();
+    latency[k] = std::chrono::duration<double, std::micro>(stop - start).count();
+  }
+  std::sort(latency.begin(), latency.end());
+  auto percentile = [&latency](double p) {return latency[std::size_t(p * double(latency.size() - 1))];};
+  std::printf("  %-6s p50 %10.2f  p99 %10.2f  max %10.2f\n", label, percentile(0.5), percentile(0.99), latency.back());
+}
+
+int
+main(
+  int    argc,
+  char * argv[]
+)
+{
+  integer     saves = argc > 1 ? std::atoi(argv[1]) : 10000;
+  std::string path  = argc > 2 ? argv[2] : (std::filesystem::temp_directory_path() / "piddle_checkpoint.state").string();
+
+  std::printf("save latency (us), %d saves (%d flushed)\n", saves, std::max(saves / 100, 10));
+  for (integer lanes : {1, 64, 4096})
+  {
+    PIDBank bank(lanes, PID(1.3, 0.7, 0.05, 30.0, 1.0, -1.0));
+    StateWriter probe;
+    bank.save(probe);
+    std::size_t capacity = probe.size() + 64;
+
+    std::filesystem::remove(path);
+    Checkpoint checkpoint(path, capacity);
+    checkpoint.add(bank);
+    checkpoint.save();
+    std::printf("%d lanes, %zu bytes snapshot\n", lanes, checkpoint.save());
+    time_saves(checkpoint, bank, saves, false, "async");
+    time_saves(checkpoint, bank, std::max(saves / 100, 10), true, "sync");
+  }
+  std::filesystem::remove(path);
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: Checkpoint.cc
+///
@@ -0,0 +1,106 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: Executor.cc
+///
+
+// Scaling of the controller executor over fleets of pid loops closed on
+// simulated first order plants, at 10 kHz, 1 kHz and 100 Hz rate classes.
+// The rate classes are run in simulated time (as fast as possible), with an
+// increasing total number of worker threads (in simulated time the rate
+// classes run one at a time on a single pool of all the workers).
+// Build:
+//   g++ -std=c++20 -O2 -pthread -I src benchmarks/Executor.cc
+// Usage: Executor [loops per rate class] [groups per rate class] [max threads] [simulated duration]
+
+#include "Piddle.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Piddle;
+
+int
+main(int argc, char ** argv)
+{
+  integer loops    = argc > 1 ? std::atoi(argv[1]) : 4096;
+  integer groups   = argc > 2 ? std::atoi(argv[2]) : 64;
+  integer threads  = argc > 3 ? std::atoi(argv[3]) : hardware_threads();
+  real    duration = argc > 4 ? std::atof(argv[4]) : 0.1;
+  real    periods[] = {1.0e-4, 1.0e-3, 1.0e-2};
+
+  // Loop steps per simulated run
+  real steps = 0.0;
+  for (real period : periods)
+    steps += real(loops) * std::round(duration / period);
+
+  std::printf("%d loops in %d groups per rate class, %g s simulated, %.3g loop steps per run\n",
+              loops, groups, duration, steps);
+  std::printf("threads   time (s)   loop steps/s   speedup   deadline misses\n");
+  // Powers of two up to the maximum number of threads, and the maximum
+  std::vector<integer> counts;
+  for (integer n = 1; n < threads; n *= 2)
+    counts.push_back(n);
+  counts.push_back(std::max(threads, integer(1)));
+
+  real reference = 0.0;
+  for (integer n : counts)
+  {
+    ControllerExecutor executor(n);
+    for (real period : periods)
+    {
+      for (integer g = 0; g < groups; ++g)
+      {
+        integer group = executor.group(period);
+        for (integer k = g; k < loops; k += groups)
+        {
+          std::shared_ptr<FirstOrderPlant> plant = std::make_shared<FirstOrderPlant>(1.0, 0.05);
+          plant->prepare(period);
+          executor.add(group, std::make_shared<PID>(2.0, 20.0, 0.0, 0.0, 10.0, -10.0),
+                       [plant]() {return 1.0 - plant->output();},
+                       [plant, period](real u) {plant->setup(u, period);});
+        }
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    executor.simulate(duration);
+    real elapsed = std::chrono::duration<real>(std::chrono::steady_clock::now() - start).count();
+
+    std::uint64_t misses = 0;
+    for (integer c = 0; c < executor.rate_classes(); ++c)
+      misses += executor.statistics(c).deadline_misses;
+    if (n == 1)
+      reference = elapsed;
+    std::printf("%7d   %8.4f   %12.4g   %7.2f   %15llu\n", n, elapsed, steps / elapsed, reference / elapsed,
+                static_cast<unsigned long long>(misses));
+  }
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: Executor.cc
+///
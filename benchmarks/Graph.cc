@@ -0,0 +1,139 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Graph.cc
+///
+
+// Throughput of a ControllerGraph of position, velocity and current cascades
+// against the same cascades chained by hand from the blocks. The pid loops of
+// the same depth of all the cascades are stepped as one stage by the PIDBank
+// kernel selected by the target flags, which is reported.
+// Build:
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src benchmarks/Graph.cc
+//   g++ -std=c++20 -O2 -ffp-contract=off -march=native -I src benchmarks/Graph.cc
+// Usage: Graph [cascades] [steps]
+
+#include "Piddle.hh"
+#include "Timing.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Piddle;
+
+//! Hand-chained position, velocity and current cascade
+struct Cascade
+{
+  PID        position; //!< Position loop
+  PID        velocity; //!< Velocity loop
+  PID        current;  //!< Current loop
+  Filter     filter;   //!< Velocity measurement filter
+  Antiwindup limit;    //!< Current command saturation
+  real       gain;     //!< Velocity feedforward gain
+};
+
+int
+main(int argc, char ** argv)
+{
+  integer n     = argc > 1 ? std::atoi(argv[1]) : 500;
+  integer steps = argc > 2 ? std::atoi(argv[2]) : 2000;
+  real    dt    = 1.0e-3;
+
+  std::mt19937_64                      rng(3);
+  std::uniform_real_distribution<real> U(-1.0, 1.0);
+
+  std::vector<Cascade> cascades;
+  ControllerGraph      graph;
+  for (integer c = 0; c < n; ++c)
+  {
+    Cascade k{PID(2.0 + U(rng), 0.5, 0.01, 0.0, 5.0, -5.0), PID(1.5, 3.0 + U(rng), 0.02, 80.0, 8.0, -8.0),
+              PID(0.8, 20.0, 0.0, 0.0, 12.0, -12.0), Filter(200.0), Antiwindup(10.0, -10.0), 0.3};
+    cascades.push_back(k);
+    ControllerGraph::node r  = graph.input();
+    ControllerGraph::node x  = graph.input();
+    ControllerGraph::node v  = graph.input();
+    ControllerGraph::node i  = graph.input();
+    ControllerGraph::node rv = graph.input();
+    ControllerGraph::node u1 = graph.pid(k.position, graph.difference(r, x), false);
+    ControllerGraph::node e2 = graph.sum({u1, graph.feedforward(rv, k.gain), graph.filter(k.filter, v)}, {1.0, 1.0, -1.0});
+    ControllerGraph::node u2 = graph.pid(k.velocity, e2, false);
+    ControllerGraph::node u3 = graph.pid(k.current, graph.difference(u2, i), false);
+    graph.output(graph.saturation(k.limit, u3));
+  }
+  graph.compile();
+
+  // Inputs are either drawn at random (saturating, unpredictable branches)
+  // or slowly varying (mostly linear operation)
+  std::vector<real> random(std::size_t(steps) * 5 * n), smooth(random.size());
+  for (real & value : random)
+    value = 3.0 * U(rng);
+  for (integer k = 0; k < steps; ++k)
+    for (integer j = 0; j < 5 * n; ++j)
+      smooth[std::size_t(k) * 5 * n + j] = 0.6 * std::sin(0.002 * k * (1 + j % 5) + j / 5) + 0.01 * U(rng);
+  std::vector<real> out(n);
+
+#if defined(__AVX512F__)
+  char const * path = "AVX-512";
+#elif defined(__AVX2__)
+  char const * path = "AVX2";
+#elif defined(__SSE2__)
+  char const * path = "SSE2";
+#else
+  char const * path = "scalar";
+#endif
+  std::printf("%d cascades, %d steps, %s pid bank kernel, ns per cascade step\n", n, steps, path);
+  for (std::vector<real> const * inputs : {&random, &smooth})
+  {
+    double t_hand = best_of(5, [&]() {
+      std::vector<Cascade> hand(cascades);
+      for (integer k = 0; k < steps; ++k)
+      {
+        real const * in = inputs->data() + std::size_t(k) * 5 * n;
+        for (integer c = 0; c < n; ++c)
+        {
+          Cascade &    h = hand[c];
+          real const * q = in + 5 * c;
+          real u1 = h.position.setup(q[0] - q[1], dt);
+          real u2 = h.velocity.setup(u1 + h.gain * q[4] - h.filter.setup(q[2], dt), dt);
+          out[c]  = h.limit.setup(h.current.setup(u2 - q[3], dt), dt);
+        }
+      }
+    });
+    double t_graph = best_of(5, [&]() {
+      graph.reset();
+      for (integer k = 0; k < steps; ++k)
+        graph.setup(std::span<real const>(inputs->data() + std::size_t(k) * 5 * n, 5 * n), dt, out);
+    });
+    double samples = double(n) * steps;
+    std::printf("%-6s inputs: hand-chained %7.2f, ControllerGraph %7.2f (speedup %.2fx)\n",
+                inputs == &random ? "random" : "smooth", t_hand / samples, t_graph / samples, t_hand / t_graph);
+  }
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: Graph.cc
+///
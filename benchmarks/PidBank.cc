@@ -0,0 +1,91 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: PidBank.cc
+///
+
+// Throughput of the PIDBank lanes against an array of PID blocks.
+// Build (the SIMD paths are selected by the target flags):
+//   g++ -std=c++20 -O2 -ffp-contract=off -march=native -I src benchmarks/PidBank.cc
+// Usage: PidBank [lanes] [steps]
+
+#include "Piddle.hh"
+#include "Timing.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Piddle;
+
+int
+main(int argc, char ** argv)
+{
+  integer lanes = argc > 1 ? std::atoi(argv[1]) : 4096;
+  integer steps = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  std::mt19937_64                      rng(7);
+  std::uniform_real_distribution<real> U(-1.0, 1.0);
+
+  std::vector<PID> pids;
+  for (integer i = 0; i < lanes; ++i)
+    pids.emplace_back(1.0 + 0.5 * U(rng), 0.5, 0.01, 20.0, 1.0, -1.0);
+  PIDBank bank;
+  for (PID const & pid : pids)
+    bank.push_back(pid);
+
+  // Errors are either held constant (predictable saturation branches) or
+  // drawn at random around the bounds (unpredictable saturation branches)
+  std::vector<real> constant(std::size_t(lanes) * steps, 0.3);
+  std::vector<real> random(std::size_t(lanes) * steps);
+  for (real & e : random)
+    e = 2.0 * U(rng);
+  std::vector<real> out(lanes);
+
+  std::printf("%d lanes, %d steps, ns per lane step\n", lanes, steps);
+  for (std::vector<real> const * errors : {&constant, &random})
+  {
+    double t_pid = best_of(5, [&]() {
+      for (integer k = 0; k < steps; ++k)
+      {
+        real const * e = errors->data() + std::size_t(k) * lanes;
+        for (integer i = 0; i < lanes; ++i)
+          out[i] = pids[i].setup(e[i], 1.0e-3);
+      }
+    });
+    double t_bank = best_of(5, [&]() {
+      for (integer k = 0; k < steps; ++k)
+        bank.setup(std::span<real const>(errors->data() + std::size_t(k) * lanes, lanes), 1.0e-3, out);
+    });
+    double samples = double(lanes) * steps;
+    std::printf("%-8s errors: PID %6.2f, PIDBank %6.2f (speedup %.2fx)\n",
+                errors == &constant ? "constant" : "random", t_pid / samples, t_bank / samples, t_pid / t_bank);
+  }
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: PidBank.cc
+///
@@ -0,0 +1,136 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: Static.cc
+///
+
+// Step cost of the statically composed controllers against the runtime
+// (virtual) blocks, and of the static controllers on other scalar types.
+// Build:
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src benchmarks/Static.cc
+// Usage: Static [steps]
+
+#include "Piddle.hh"
+#include "Timing.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Piddle;
+
+typedef BasicDerivative<real, BasicFilter<real>>                                                       FilteredDerivative;
+typedef BasicPID<real, BasicProportional<real>, BasicIntegral<real>, FilteredDerivative, BasicAntiwindup<real>> StaticPID;
+
+real volatile sink = 0.0; //!< Sink of the controller outputs
+
+//! Error samples (a slow sine wave, so that the bounds are hit periodically)
+static std::vector<real> const &
+errors(void)
+{
+  static std::vector<real> samples = []() {
+    std::vector<real> out(4096);
+    for (std::size_t i = 0; i < out.size(); ++i)
+      out[i] = 3.0 * std::sin(real(i) * 1.0e-2);
+    return out;
+  }();
+  return samples;
+}
+
+//! Best time in nanoseconds per step of a few repetitions of a controller step
+template <typename Step>
+static double
+ns_per_step(
+  integer steps, //!< Number of steps
+  Step    step   //!< Controller step callable (error to output)
+)
+{
+  std::vector<real> const & e   = errors();
+  real                      sum = 0.0;
+  double best = best_of(5, [&]() {
+    for (integer k = 0; k < steps; ++k)
+      sum += step(e[std::size_t(k) & 4095]);
+  });
+  sink = sum;
+  return best / steps;
+}
+
+int
+main(int argc, char ** argv)
+{
+  integer steps = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  real    dt    = 1.0e-3;
+
+  // Runtime blocks are called through a base pointer picked at run time, so
+  // that the compiler cannot devirtualize the calls
+  static integer volatile offset = 0;
+  Proportional            p(1.3);
+  PID                     pi(1.3, 0.7);
+  PID                     pid(1.3, 0.7, 0.05, 30.0, 1.0, -1.0);
+  Block *                 blocks[]  = {&p, &pi, &pid};
+  Block *                 p_block   = blocks[offset + 0];
+  Block *                 pi_block  = blocks[offset + 1];
+  Block *                 pid_block = blocks[offset + 2];
+
+  BasicP<real>  p_static(BasicProportional<real>(1.3));
+  BasicPI<real> pi_static(BasicProportional<real>(1.3), BasicIntegral<real>(0.7));
+  StaticPID     pid_static(BasicProportional<real>(1.3), BasicIntegral<real>(0.7),
+                           FilteredDerivative(0.05, BasicFilter<real>(30.0)), BasicAntiwindup<real>(1.0, -1.0));
+
+  // The static and runtime pid controllers must agree bit for bit
+  std::size_t mismatches = 0;
+  for (real e : errors())
+  {
+    real a = pid_static.setup(e, dt);
+    real b = pid.setup(e, dt);
+    mismatches += std::memcmp(&a, &b, sizeof(real)) != 0;
+  }
+  std::printf("static/runtime pid mismatches: %zu\n", mismatches);
+
+  std::printf("ns per step        static  virtual\n");
+  std::printf("P                  %6.2f   %6.2f\n",
+              ns_per_step(steps, [&](real e) {return p_static.setup(e, dt);}),
+              ns_per_step(steps, [&](real e) {return p_block->setup(e, dt);}));
+  std::printf("PI                 %6.2f   %6.2f\n",
+              ns_per_step(steps, [&](real e) {return pi_static.setup(e, dt);}),
+              ns_per_step(steps, [&](real e) {return pi_block->setup(e, dt);}));
+  std::printf("PID                %6.2f   %6.2f\n",
+              ns_per_step(steps, [&](real e) {return pid_static.setup(e, dt);}),
+              ns_per_step(steps, [&](real e) {return pid_block->setup(e, dt);}));
+
+  // Static pi controllers on narrower scalar types
+  typedef Fixed<16> fixed;
+  BasicPI<float> pi_float(BasicProportional<float>(1.3f), BasicIntegral<float>(0.7f));
+  BasicPI<fixed> pi_fixed(BasicProportional<fixed>(fixed(1.3)), BasicIntegral<fixed>(fixed(0.7)));
+  std::printf("PI float           %6.2f\n",
+              ns_per_step(steps, [&](real e) {return real(pi_float.setup(float(e), float(dt)));}));
+  std::printf("PI Fixed<16>       %6.2f\n",
+              ns_per_step(steps, [&](real e) {return real(pi_fixed.setup(fixed(e), fixed(dt)));}));
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Static.cc
+///
@@ -0,0 +1,144 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Telemetry.cc
+///
+
+// Step cost of a static pid with telemetry disabled (NoProbe) against the
+// ring buffer probe, detached, attached to a channel drained between the
+// timed batches, and attached to a channel drained by a background thread.
+// The cost of the record timestamp alone is reported too, since it depends
+// on the clock source (e.g. a virtualized time-stamp counter).
+// Build:
+//   g++ -std=c++20 -O2 -pthread -I src benchmarks/Telemetry.cc
+// Usage: Telemetry [steps] [telemetry file path]
+
+#include "Piddle.hh"
+#include "Timing.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Piddle;
+
+template <typename Probe>
+using ProbedPID = BasicPID<real, BasicProportional<real>, BasicIntegral<real>,
+                           BasicDerivative<real, BasicFilter<real>>, BasicAntiwindup<real>, Probe>;
+
+real volatile sink = 0.0; //!< Sink of the controller outputs
+
+//! Build a probed pid controller
+template <typename Probe>
+static ProbedPID<Probe>
+make_pid(
+  Probe probe //!< Telemetry probe
+)
+{
+  return ProbedPID<Probe>(BasicProportional<real>(1.3), BasicIntegral<real>(0.7),
+                          BasicDerivative<real, BasicFilter<real>>(0.05, BasicFilter<real>(30.0)),
+                          BasicAntiwindup<real>(1.0, -1.0), std::move(probe));
+}
+
+//! Best time in nanoseconds per step, run in batches of half a channel
+//! capacity with a callback between the batches (not timed)
+template <typename PIDType, typename Between>
+static double
+ns_per_step(
+  PIDType &                 pid,     //!< Pid controller
+  std::vector<real> const & errors,  //!< Error samples
+  Between &&                between  //!< Callback run between the batches
+)
+{
+  std::size_t const batch = PIDDLE_TELEMETRY_CAPACITY / 2;
+  double            total = 0.0;
+  real              sum   = 0.0;
+  for (std::size_t first = 0; first < errors.size(); first += batch)
+  {
+    std::size_t last = std::min(first + batch, errors.size());
+    total += best_of(1, [&]() {
+      for (std::size_t k = first; k < last; ++k)
+        sum += pid.setup(errors[k], 1.0e-3);
+    });
+    between();
+  }
+  sink = sum;
+  return total / double(errors.size());
+}
+
+int
+main(int argc, char ** argv)
+{
+  std::size_t steps = argc > 1 ? std::size_t(std::atoll(argv[1])) : 10000000;
+  std::string path  = argc > 2 ? argv[2] : "piddle_telemetry.bin";
+
+  std::vector<real> errors(steps);
+  for (std::size_t k = 0; k < steps; ++k)
+    errors[k] = 3.0 * std::sin(real(k) * 1.0e-2);
+
+  std::shared_ptr<TelemetryChannel> channel = std::make_shared<TelemetryChannel>();
+  TelemetryDrainer                  drainer(path);
+  drainer.add(channel);
+
+  ProbedPID<NoProbe>   disabled = make_pid(NoProbe());
+  ProbedPID<RingProbe> detached = make_pid(RingProbe());
+  ProbedPID<RingProbe> attached = make_pid(RingProbe(channel, 1));
+  auto nothing = []() {};
+
+  std::printf("%zu steps, ns per step (best of 3)\n", steps);
+  double t_disabled = INFTY, t_detached = INFTY, t_drained = INFTY, t_background = INFTY;
+  for (integer r = 0; r < 3; ++r)
+  {
+    t_disabled = std::min(t_disabled, ns_per_step(disabled, errors, nothing));
+    t_detached = std::min(t_detached, ns_per_step(detached, errors, nothing));
+    t_drained  = std::min(t_drained, ns_per_step(attached, errors, [&drainer]() {drainer.drain();}));
+  }
+  std::uint64_t dropped = channel->dropped();
+  drainer.start();
+  for (integer r = 0; r < 3; ++r)
+    t_background = std::min(t_background, ns_per_step(attached, errors, nothing));
+  drainer.stop();
+  drainer.drain();
+  std::uint64_t ticks = 0;
+  double        t_clock = best_of(3, [&]() {
+    for (std::size_t k = 0; k < steps; ++k)
+      ticks += telemetry_ticks();
+  }) / double(steps);
+  sink = real(ticks & 1);
+  std::printf("NoProbe                        %6.2f\n", t_disabled);
+  std::printf("RingProbe, detached            %6.2f\n", t_detached);
+  std::printf("RingProbe, drained in between  %6.2f (%llu dropped)\n", t_drained,
+              static_cast<unsigned long long>(dropped));
+  std::printf("RingProbe, background drainer  %6.2f (%llu dropped)\n", t_background,
+              static_cast<unsigned long long>(channel->dropped() - dropped));
+  std::printf("telemetry_ticks() alone        %6.2f\n", t_clock);
+  std::printf("%llu records written\n", static_cast<unsigned long long>(drainer.records()));
+  std::remove(path.c_str());
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: Telemetry.cc
+///
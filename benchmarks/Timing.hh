@@ -0,0 +1,60 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Timing.hh
+///
+
+// Timing helpers shared by the benchmarks.
+
+#ifndef INCLUDE_PIDDLE_BENCHMARKS_TIMING
+#define INCLUDE_PIDDLE_BENCHMARKS_TIMING
+
+#include "Piddle.hh"
+
+#include <algorithm>
+#include <chrono>
+
+//! Best wall time in nanoseconds of a few repetitions of a callable
+template <typename Function>
+static double
+best_of(
+  Piddle::integer repetitions, //!< Number of repetitions
+  Function &&     function     //!< Timed callable
+)
+{
+  double best = Piddle::INFTY;
+  for (Piddle::integer r = 0; r < repetitions; ++r)
+  {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  return best;
+}
+
+#endif
+
+///
+/// eof: Timing.hh
+///
@@ -0,0 +1,124 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: Trace.cc
+///
+
+// Batch evaluation of blocks over recorded error traces: per-sample virtual
+// setup calls against the batch process method, and the streaming throughput
+// of a memory-mapped trace through a block in chunks.
+// Build:
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src benchmarks/Trace.cc
+// Usage: Trace [samples] [trace file path]
+
+#include "Piddle.hh"
+#include "Timing.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Piddle;
+
+int
+main(int argc, char ** argv)
+{
+  std::size_t samples = argc > 1 ? std::size_t(std::atoll(argv[1])) : std::size_t(1) << 24;
+  std::string path    = argc > 2 ? argv[2] : "piddle_trace.bin";
+  real        dt[]    = {1.0e-3};
+
+  // White noise (unpredictable saturations) and smooth error traces
+  std::mt19937_64                      rng(11);
+  std::uniform_real_distribution<real> U(-2.0, 2.0);
+  std::vector<real>                    noise(samples), smooth(samples);
+  for (std::size_t k = 0; k < samples; ++k)
+  {
+    noise[k]  = U(rng);
+    smooth[k] = 0.8 * std::sin(real(k) * 1.0e-3) + 0.05 * std::sin(real(k) * 3.7e-2);
+  }
+
+  // Blocks under test (called through base pointers picked at run time, so
+  // that the per-sample calls are not devirtualized)
+  std::vector<std::function<std::unique_ptr<Block>(void)>> makers = {
+    []() {return std::unique_ptr<Block>(new PID(1.3, 20.0, 0.05, 30.0, 1.0, -1.0));},
+    []() {return std::unique_ptr<Block>(new Integral(0.5));},
+    []() {return std::unique_ptr<Block>(new Filter(20.0));},
+    []() {return std::unique_ptr<Block>(new Derivative(0.1, 30.0));}
+  };
+  char const * names[] = {"PID", "Integral", "Filter", "Derivative"};
+
+  std::vector<real> reference(samples), out(samples);
+  integer           failures = 0;
+  std::printf("%zu samples, ns per sample (setup loop / process / mapped trace stream)\n", samples);
+  for (std::vector<real> const * trace : {&noise, &smooth})
+  {
+    write_trace(path, *trace);
+    MappedTrace mapped(path);
+    std::span<real const> input = mapped.samples();
+    std::printf("%s trace\n", trace == &noise ? "white noise" : "smooth");
+    for (std::size_t b = 0; b < makers.size(); ++b)
+    {
+      std::unique_ptr<Block> block = makers[b]();
+      Block * volatile       target = block.get();
+
+      double t_setup = best_of(3, [&]() {
+        Block * blk = target;
+        blk->reset();
+        for (std::size_t k = 0; k < samples; ++k)
+          reference[k] = blk->setup(input[k], dt[0]);
+      });
+      double t_process = best_of(3, [&]() {
+        Block * blk = target;
+        blk->reset();
+        blk->process(input, dt, out);
+      });
+      failures += std::memcmp(reference.data(), out.data(), samples * sizeof(real)) != 0;
+      real sum = 0.0;
+      double t_stream = best_of(3, [&]() {
+        Block * blk = target;
+        blk->reset();
+        sum = 0.0;
+        mapped.process(*blk, dt, [&sum](std::size_t, std::span<real const> chunk) {
+          for (real value : chunk)
+            sum += value;
+        });
+      });
+      std::printf("  %-10s %6.2f / %6.2f / %6.2f (%.0f MB/s streamed, checksum %g)\n", names[b],
+                  t_setup / samples, t_process / samples, t_stream / samples,
+                  1.0e3 * samples * sizeof(real) / t_stream, sum);
+    }
+  }
+  std::remove(path.c_str());
+  if (failures != 0)
+    std::printf("FAILED: %d batch outputs differ from the setup loop outputs\n", failures);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Trace.cc
+///
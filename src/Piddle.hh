@@ -44,11 +44,18 @@
   PIDDLE_ERROR(MSG)
 #endif
 
+// Pid blocks telemetry probes are compiled only if PIDDLE_TELEMETRY is
+// defined (consistently across translation units) before including piddle
+
 // Standard libraries
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <span>
+#include <sstream>
+#include <stdexcept>
 
 //! Namespace containing all piddle typedefs, classes and routines
 namespace Piddle
@@ -63,7 +70,7 @@ namespace Piddle
    |        |___/|_|
   \*/
 
-  typedef double real;             //!< Real number type
+  typedef double real;             //!< Real number type (scalar type of the runtime blocks)
   typedef int integer;             //!< Integer number type
   typedef std::ostream out_stream; //!< Output stream type
 
@@ -89,11 +96,27 @@ namespace Piddle
 } // namespace Piddle
 
 #include "Piddle/Antiwindup.hxx"
+#include "Piddle/Autotune.hxx"
 #include "Piddle/Block.hxx"
+#include "Piddle/Butterworth.hxx"
+#include "Piddle/Checkpoint.hxx"
+#include "Piddle/Derivative.hxx"
+#include "Piddle/Executor.hxx"
 #include "Piddle/Filter.hxx"
+#include "Piddle/Fixed.hxx"
+#include "Piddle/Graph.hxx"
 #include "Piddle/Integral.hxx"
+#include "Piddle/MovingAverage.hxx"
 #include "Piddle/Pid.hxx"
+#include "Piddle/PidBank.hxx"
+#include "Piddle/Plant.hxx"
 #include "Piddle/Proportional.hxx"
+#include "Piddle/RingBuffer.hxx"
+#include "Piddle/State.hxx"
+#include "Piddle/Telemetry.hxx"
+#include "Piddle/ThreadPool.hxx"
+#include "Piddle/Trace.hxx"
+#include "Piddle/TripleBuffer.hxx"
 
 #endif
 
@@ -41,21 +41,185 @@ namespace Piddle
    |                                                   |_|
   \*/
 
+  //! Get the largest representable value of a scalar type (infinity if available)
+  template <typename Scalar>
+  Scalar
+  scalar_upper(void)
+  {
+    if constexpr (std::numeric_limits<Scalar>::has_infinity)
+      return std::numeric_limits<Scalar>::infinity();
+    else
+      return std::numeric_limits<Scalar>::max();
+  }
+
+  //! Get the lowest representable value of a scalar type (minus infinity if available)
+  template <typename Scalar>
+  Scalar
+  scalar_lower(void)
+  {
+    if constexpr (std::numeric_limits<Scalar>::has_infinity)
+      return -std::numeric_limits<Scalar>::infinity();
+    else
+      return std::numeric_limits<Scalar>::lowest();
+  }
+
+  //! Class to represent a static antiwindup block
+  template <typename Scalar>
+  class BasicAntiwindup
+  {
+  private:
+    Scalar m_upper; //!< Upper bound
+    Scalar m_lower; //!< Lower bound
+
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+    //! Class constructor
+    BasicAntiwindup(
+      Scalar upper = scalar_upper<Scalar>(), //!< Upper bound
+      Scalar lower = scalar_lower<Scalar>()  //!< Lower bound
+    )
+      : m_upper(upper), m_lower(lower)
+    {
+    }
+
+    //! Get upper bound reference
+    Scalar &
+    upper(void)
+    {
+      return this->m_upper;
+    }
+
+    //! Get upper bound const reference
+    Scalar const &
+    upper(void) const
+    {
+      return this->m_upper;
+    }
+
+    //! Get lower bound reference
+    Scalar &
+    lower(void)
+    {
+      return this->m_lower;
+    }
+
+    //! Get lower bound const reference
+    Scalar const &
+    lower(void) const
+    {
+      return this->m_lower;
+    }
+
+    //! Get conditional integration
+    Scalar
+    integration(
+      Scalar input //!< Input value
+    )
+    const
+    {
+      if (input > this->m_upper)
+        return Scalar(0.0);
+      else if (input < this->m_lower)
+        return Scalar(0.0);
+      else
+        return Scalar(1.0);
+    }
+
+    //! Setup anti-windup component
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar        //!< Time step
+    )
+    const
+    {
+      if (input > this->m_upper)
+        return this->m_upper;
+      else if (input < this->m_lower)
+        return this->m_lower;
+      else
+        return input;
+    }
+
+    //! Save anti-windup component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_upper);
+      writer.write(this->m_lower);
+    }
+
+    //! Restore anti-windup component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_upper);
+      reader.read(this->m_lower);
+    }
+
+    //! Reset anti-windup block components
+    void
+    reset(void)
+    {
+    }
+
+  }; // class BasicAntiwindup
+
+  //! Class to represent a removed static antiwindup block
+  template <typename Scalar>
+  class NoAntiwindup
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Component presence flag
+
+    //! Get conditional integration
+    Scalar
+    integration(
+      Scalar //!< Input value
+    )
+    const
+    {
+      return Scalar(1.0);
+    }
+
+    //! Setup anti-windup component (pass-through)
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar        //!< Time step
+    )
+    const
+    {
+      return input;
+    }
+
+    //! Reset anti-windup block components
+    void
+    reset(void)
+    {
+    }
+
+  }; // class NoAntiwindup
+
   //! Class to represent antiwindup block
   class Antiwindup : public Block
   {
   private:
-    real m_upper;                   //!< Upper bound
-    real m_lower;                   //!< Lower bound
-    real m_integration = real(0.0); //!< Conditional integration scaling factor
+    BasicAntiwindup<real> m_core; //!< Static anti-windup component
 
   public:
     //! Class constructor
     Antiwindup(
-      real upper, //!< Upper bound
-      real lower  //!< Lower bound
+      real upper = INFTY, //!< Upper bound
+      real lower = -INFTY //!< Lower bound
     )
-      : m_upper(upper), m_lower(lower)
+      : m_core(upper, lower)
     {
     }
 
@@ -63,28 +227,28 @@ namespace Piddle
     real &
     upper(void)
     {
-      return this->m_upper;
+      return this->m_core.upper();
     }
 
     //! Get upper bound const reference
     real const &
     upper(void) const
     {
-      return this->m_upper;
+      return this->m_core.upper();
     }
 
     //! Get lower bound reference
     real &
     lower(void)
     {
-      return this->m_lower;
+      return this->m_core.lower();
     }
 
     //! Get lower bound const reference
     real const &
     lower(void) const
     {
-      return this->m_lower;
+      return this->m_core.lower();
     }
 
     //! Get conditional integration
@@ -94,10 +258,8 @@ namespace Piddle
     )
     const
     {
-      if (input > this->m_upper)
-        return real(0.0);
-      else if (input < this->m_lower)
-        return real(0.0);
+      if (this->is_enabled())
+        return this->m_core.integration(input);
       else
         return real(1.0);
     }
@@ -108,33 +270,48 @@ namespace Piddle
       real input, //!< Input value
       real dt     //!< Time step
     )
-    const override
+    override
     {
       if (this->is_enabled())
-      {
-        if (input > this->m_upper)
-        {
-          return this->m_upper;
-        }
-        else if (input < this->m_lower)
-        {
-          return this->m_lower;
-        }
-        else
-        {
-          return input;
-        }
-      }
+        return this->m_core.setup(input, dt);
       else
-      {
         return input;
-      }
+    }
+
+    //! Save anti-windup component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_ANTIWINDUP);
+      this->m_core.save(writer);
+    }
+
+    //! Restore anti-windup component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_ANTIWINDUP);
+      this->m_core.restore(reader);
     }
 
     //! Reset anti-windup block components
-    real
+    void
     reset(void) override
     {
+      this->m_core.reset();
+    }
+
+    //! Get a copy of the anti-windup block
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<Antiwindup>(*this);
     }
 
   }; // class Antiwindup
@@ -0,0 +1,734 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Autotune.hh
+///
+
+#ifndef INCLUDE_PIDDLE_AUTOTUNE
+#define INCLUDE_PIDDLE_AUTOTUNE
+
+#include "Pid.hxx"
+#include "Plant.hxx"
+#include "ThreadPool.hxx"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace Piddle
+{
+
+  /*\
+   |      _          _         _
+   |     / \   _   _| |_  ___ | |_ _   _ _ __   ___
+   |    / _ \ | | | | __|/ _ \| __| | | | '_ \ / _ \
+   |   / ___ \| |_| | |_| (_) | |_| |_| | | | |  __/
+   |  /_/   \_\\__,_|\__|\___/ \__|\__,_|_| |_|\___|
+   |
+  \*/
+
+  //! Closed loop setpoint step scenario used to score a parameter set
+  struct TuningScenario
+  {
+    real setpoint = real(1.0);  //!< Setpoint step amplitude
+    real duration = real(10.0); //!< Simulated time (s)
+    real dt       = real(1e-3); //!< Time step (s)
+  };
+
+  //! Weights of the step response metrics in the tuning cost
+  struct TuningWeights
+  {
+    real iae        = real(1.0); //!< Integral of the absolute error weight
+    real itae       = real(0.0); //!< Integral of the time-weighted absolute error weight
+    real overshoot  = real(0.0); //!< Relative overshoot weight
+    real saturation = real(0.0); //!< Saturation time weight
+  };
+
+  //! Step response metrics of a parameter set
+  struct TuningMetrics
+  {
+    real iae        = real(0.0); //!< Integral of the absolute error
+    real itae       = real(0.0); //!< Integral of the time-weighted absolute error
+    real overshoot  = real(0.0); //!< Relative overshoot
+    real saturation = real(0.0); //!< Time spent on the anti-windup bounds (s)
+    real cost       = INFTY;     //!< Weighted cost (infinite for diverging loops)
+  };
+
+  //! Simulate a closed loop setpoint step and score it. The controller and the
+  //! plant are reset and the plant is prepared for the time step before the
+  //! loop, so that the simulation loop itself does not allocate.
+  template <typename PlantType>
+  TuningMetrics
+  simulate_step_response(
+    PID &                  controller, //!< Controller
+    PlantType &            plant,      //!< Plant
+    TuningScenario const & scenario,   //!< Step scenario
+    TuningWeights const &  weights     //!< Metric weights
+  )
+  {
+    PIDDLE_ASSERT(scenario.dt > real(0.0) && scenario.duration > real(0.0),
+      "Piddle::simulate_step_response(...): non-positive time step or duration.");
+    controller.reset();
+    plant.reset();
+    plant.prepare(scenario.dt);
+
+    Antiwindup const & antiwindup = controller.antiwindup();
+    real          upper    = antiwindup.is_enabled() ? antiwindup.upper() : INFTY;
+    real          lower    = antiwindup.is_enabled() ? antiwindup.lower() : -INFTY;
+    real          setpoint = scenario.setpoint;
+    real          dt       = scenario.dt;
+    real          output   = plant.output();
+    real          peak     = output;
+    std::uint64_t steps    = std::uint64_t(std::llround(scenario.duration / dt));
+    TuningMetrics metrics;
+    for (std::uint64_t k = 0; k < steps; ++k)
+    {
+      real error  = setpoint - output;
+      real input  = controller.setup(error, dt);
+      real time   = real(k) * dt;
+      if (input >= upper || input <= lower)
+        metrics.saturation += dt;
+      output = plant.setup(input, dt);
+      metrics.iae  += std::abs(error) * dt;
+      metrics.itae += time * std::abs(error) * dt;
+      peak = setpoint < real(0.0) ? std::min(peak, output) : std::max(peak, output);
+      if (!std::isfinite(output))
+        return metrics;
+    }
+    if (setpoint != real(0.0))
+      metrics.overshoot = std::max(real(0.0), (peak - setpoint) / setpoint);
+    metrics.cost = weights.iae * metrics.iae + weights.itae * metrics.itae +
+                   weights.overshoot * metrics.overshoot + weights.saturation * metrics.saturation;
+    return metrics;
+  }
+
+  //! Ultimate point estimate of a relay feedback experiment
+  struct RelayEstimate
+  {
+    real    ultimate_gain   = real(0.0); //!< Ultimate gain
+    real    ultimate_period = real(0.0); //!< Ultimate period (s)
+    real    amplitude       = real(0.0); //!< Output oscillation amplitude
+    integer cycles          = 0;         //!< Number of averaged cycles
+    bool    valid           = false;     //!< Sustained oscillation flag
+  };
+
+  //! Run a relay feedback experiment around a setpoint (Astrom-Hagglund). The
+  //! relay switches between +/- amplitude with the given hysteresis, the
+  //! first transient cycles are skipped, and the ultimate gain is estimated
+  //! from the describing function 4*d/(pi*sqrt(a^2 - h^2)).
+  template <typename PlantType>
+  RelayEstimate
+  relay_feedback(
+    PlantType & plant,                  //!< Plant
+    real        amplitude,              //!< Relay amplitude
+    real        hysteresis = real(0.0), //!< Relay hysteresis
+    real        dt         = real(1e-3), //!< Time step (s)
+    real        duration   = real(60.0), //!< Experiment duration (s)
+    real        setpoint   = real(0.0), //!< Relay setpoint
+    integer     skip       = 2          //!< Number of skipped transient cycles
+  )
+  {
+    PIDDLE_ASSERT(amplitude > real(0.0) && !(hysteresis < real(0.0)),
+      "Piddle::relay_feedback(...): non-positive amplitude or negative hysteresis.");
+    plant.reset();
+    plant.prepare(dt);
+
+    RelayEstimate estimate;
+    real          input   = amplitude;
+    real          output  = plant.output();
+    real          maximum = -INFTY;
+    real          minimum = INFTY;
+    real          last    = -real(1.0);
+    real          periods = real(0.0);
+    real          heights = real(0.0);
+    integer       seen    = 0;
+    std::uint64_t steps   = std::uint64_t(std::llround(duration / dt));
+    for (std::uint64_t k = 0; k < steps; ++k)
+    {
+      real time  = real(k) * dt;
+      real error = setpoint - output;
+      if (input > real(0.0) && error < -hysteresis)
+        input = -amplitude;
+      else if (input < real(0.0) && error > hysteresis)
+      {
+        // An upward switch closes a cycle
+        input = amplitude;
+        if (!(last < real(0.0)))
+        {
+          if (seen >= skip)
+          {
+            periods += time - last;
+            heights += real(0.5) * (maximum - minimum);
+            ++estimate.cycles;
+          }
+          ++seen;
+        }
+        last    = time;
+        maximum = -INFTY;
+        minimum = INFTY;
+      }
+      output  = plant.setup(input, dt);
+      maximum = std::max(maximum, output);
+      minimum = std::min(minimum, output);
+    }
+    if (estimate.cycles < 2)
+      return estimate;
+    estimate.ultimate_period = periods / real(estimate.cycles);
+    estimate.amplitude       = heights / real(estimate.cycles);
+    if (!(estimate.amplitude > hysteresis))
+      return estimate;
+    estimate.ultimate_gain = real(4.0) * amplitude /
+      (PI * std::sqrt(estimate.amplitude * estimate.amplitude - hysteresis * hysteresis));
+    estimate.valid = true;
+    return estimate;
+  }
+
+  //! Ziegler-Nichols ultimate point tuning rules
+  enum ZieglerNichols : integer
+  {
+    ZN_P              = 0, //!< Proportional only
+    ZN_PI             = 1, //!< Proportional-integral
+    ZN_PID            = 2, //!< Classic proportional-integral-derivative
+    ZN_PESSEN         = 3, //!< Pessen integral rule
+    ZN_SOME_OVERSHOOT = 4, //!< Some overshoot rule
+    ZN_NO_OVERSHOOT   = 5  //!< No overshoot rule
+  };
+
+  //! Get a parameter set from an ultimate point estimate through a
+  //! Ziegler-Nichols rule (filter and anti-windup bounds are left unset)
+  inline
+  PIDParameters
+  ziegler_nichols(
+    RelayEstimate const & estimate,    //!< Ultimate point estimate
+    ZieglerNichols        rule = ZN_PID //!< Tuning rule
+  )
+  {
+    PIDDLE_ASSERT(estimate.valid,
+      "Piddle::ziegler_nichols(...): invalid ultimate point estimate.");
+    // Gain, integral time and derivative time factors of the rules
+    static constexpr real RULES[6][3] = {
+      {0.50, 0.0,       0.0      },
+      {0.45, 1.0 / 1.2, 0.0      },
+      {0.60, 0.5,       0.125    },
+      {0.70, 0.4,       0.15     },
+      {0.33, 0.5,       1.0 / 3.0},
+      {0.20, 0.5,       1.0 / 3.0}
+    };
+    PIDDLE_ASSERT(rule >= ZN_P && rule <= ZN_NO_OVERSHOOT,
+      "Piddle::ziegler_nichols(...): invalid rule " << rule << ".");
+    real const * factors = RULES[rule];
+    PIDParameters out;
+    out.kp = factors[0] * estimate.ultimate_gain;
+    out.ki = factors[1] > real(0.0) ? out.kp / (factors[1] * estimate.ultimate_period) : real(0.0);
+    out.kd = out.kp * factors[2] * estimate.ultimate_period;
+    return out;
+  }
+
+  //! Box bounds of the tuning search space. A parameter whose bounds coincide
+  //! is kept fixed; free parameters must have finite bounds.
+  struct TuningBounds
+  {
+    PIDParameters lower; //!< Lower parameter bounds
+    PIDParameters upper; //!< Upper parameter bounds
+  };
+
+  //! Tuning result
+  struct TuningResult
+  {
+    PIDParameters parameters;      //!< Best parameter set
+    TuningMetrics metrics;         //!< Best parameter set metrics
+    integer       evaluations = 0; //!< Number of simulated candidates
+  };
+
+  //! Class to represent a parallel gain tuning engine. Candidate parameter sets
+  //! of a controller prototype are scored through closed loop step simulations
+  //! on copies of a plant prototype, spread across a work-stealing thread
+  //! pool. Every task owns a preallocated controller and plant copy, so that
+  //! the simulations do not allocate, and all random draws happen on the
+  //! calling thread from a fixed seed, so that results do not depend on the
+  //! number of threads or on the scheduling.
+  template <typename PlantType>
+  class Autotuner
+  {
+  public:
+    static constexpr integer DIMENSIONS = 6; //!< Number of tuned parameters
+    typedef std::array<real, DIMENSIONS> Point; //!< Normalised parameter point
+
+  private:
+    ThreadPool                 m_pool;        //!< Work-stealing thread pool
+    PlantType                  m_plant;       //!< Plant prototype
+    PID                        m_controller;  //!< Controller prototype
+    TuningBounds               m_bounds;      //!< Search space bounds
+    TuningScenario             m_scenario;    //!< Step scenario
+    TuningWeights              m_weights;     //!< Metric weights
+    std::uint64_t              m_seed;        //!< Random seed
+    std::vector<PID>           m_controllers; //!< Per-task controller copies
+    std::vector<PlantType>     m_plants;      //!< Per-task plant copies
+    std::vector<PIDParameters> m_candidates;  //!< Candidate batch
+    std::vector<TuningMetrics> m_metrics;     //!< Candidate batch metrics
+
+  public:
+    //! Class constructor
+    Autotuner(
+      PlantType const &    plant,                        //!< Plant prototype
+      PID const &          controller,                   //!< Controller prototype
+      TuningBounds const & bounds,                       //!< Search space bounds
+      std::uint64_t        seed    = 0,                  //!< Random seed
+      integer              threads = hardware_threads()  //!< Number of worker threads
+    )
+      : m_pool(threads), m_plant(plant), m_controller(controller), m_bounds(bounds), m_seed(seed)
+    {
+      for (integer i = 0; i < DIMENSIONS; ++i)
+      {
+        real lo = coordinate(this->m_bounds.lower, i);
+        real hi = coordinate(this->m_bounds.upper, i);
+        PIDDLE_ASSERT(!(hi < lo) && (lo == hi || (std::isfinite(lo) && std::isfinite(hi))),
+          "Piddle::Autotuner::Autotuner(...): invalid bounds [" << lo << ", " << hi << "] of parameter " << i << ".");
+      }
+    }
+
+    //! Get the number of worker threads
+    integer
+    threads(void) const
+    {
+      return this->m_pool.size();
+    }
+
+    //! Get search space bounds const reference
+    TuningBounds const &
+    bounds(void) const
+    {
+      return this->m_bounds;
+    }
+
+    //! Get step scenario const reference
+    TuningScenario const &
+    scenario(void) const
+    {
+      return this->m_scenario;
+    }
+
+    //! Get step scenario reference
+    TuningScenario &
+    scenario(void)
+    {
+      return this->m_scenario;
+    }
+
+    //! Get metric weights const reference
+    TuningWeights const &
+    weights(void) const
+    {
+      return this->m_weights;
+    }
+
+    //! Get metric weights reference
+    TuningWeights &
+    weights(void)
+    {
+      return this->m_weights;
+    }
+
+    //! Get random seed const reference
+    std::uint64_t const &
+    seed(void) const
+    {
+      return this->m_seed;
+    }
+
+    //! Get random seed reference
+    std::uint64_t &
+    seed(void)
+    {
+      return this->m_seed;
+    }
+
+    //! Score a single parameter set on the calling thread
+    TuningMetrics
+    evaluate(
+      PIDParameters const & parameters //!< Parameter set
+    )
+    {
+      this->workspaces(1);
+      return this->simulate(0, parameters);
+    }
+
+    //! Score a batch of parameter sets in parallel
+    void
+    evaluate(
+      std::span<PIDParameters const> candidates, //!< Parameter sets
+      std::span<TuningMetrics>       metrics     //!< Parameter sets metrics
+    )
+    {
+      PIDDLE_ASSERT(candidates.size() == metrics.size(),
+        "Piddle::Autotuner::evaluate(...): metrics size " << metrics.size() << " does not match candidates size " << candidates.size() << ".");
+      // A few contiguous slices per worker leave room for work stealing
+      integer count = integer(candidates.size());
+      integer tasks = std::min(count, std::max(integer(1), 4 * this->threads()));
+      this->workspaces(tasks);
+      auto task = [this, candidates, metrics, count, tasks](integer t)
+      {
+        integer begin = integer((std::int64_t(count) * t) / tasks);
+        integer end   = integer((std::int64_t(count) * (t + 1)) / tasks);
+        for (integer k = begin; k < end; ++k)
+          metrics[k] = this->simulate(t, candidates[k]);
+      };
+      this->m_pool.run(tasks, task);
+    }
+
+    //! Exhaustive grid search with the given number of points per free
+    //! parameter (one point samples the middle of the bounds)
+    TuningResult
+    grid(
+      integer points //!< Number of points per free parameter
+    )
+    {
+      PIDDLE_ASSERT(points > 0,
+        "Piddle::Autotuner::grid(...): non-positive number of points " << points << ".");
+      std::array<integer, DIMENSIONS> free;
+      integer       dimensions = this->free_dimensions(free);
+      std::uint64_t total      = 1;
+      for (integer i = 0; i < dimensions; ++i)
+      {
+        total *= std::uint64_t(points);
+        PIDDLE_ASSERT(total <= std::uint64_t(std::numeric_limits<integer>::max()),
+          "Piddle::Autotuner::grid(...): too many grid points.");
+      }
+
+      // Candidates are evaluated in fixed size batches to bound the memory
+      constexpr std::uint64_t BATCH = 4096;
+      TuningResult result;
+      result.parameters = this->project(this->m_controller.parameters());
+      for (std::uint64_t base = 0; base < total; base += BATCH)
+      {
+        std::size_t n = std::size_t(std::min(BATCH, total - base));
+        this->m_candidates.resize(n);
+        this->m_metrics.resize(n);
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          Point         point = {};
+          std::uint64_t index = base + k;
+          for (integer i = 0; i < dimensions; ++i)
+          {
+            integer step = integer(index % std::uint64_t(points));
+            index /= std::uint64_t(points);
+            point[free[i]] = points == 1 ? real(0.5) : real(step) / real(points - 1);
+          }
+          this->m_candidates[k] = this->denormalise(point);
+        }
+        this->evaluate(this->m_candidates, this->m_metrics);
+        for (std::size_t k = 0; k < n; ++k)
+          if (this->m_metrics[k].cost < result.metrics.cost)
+          {
+            result.parameters = this->m_candidates[k];
+            result.metrics    = this->m_metrics[k];
+          }
+      }
+      result.evaluations = integer(total);
+      return result;
+    }
+
+    //! Multi-start Nelder-Mead search in the normalised bounds box. The first
+    //! start is the controller prototype parameter set (projected on the
+    //! bounds), the others are drawn uniformly from the seed, and the starts
+    //! run in parallel, each one on its own controller and plant copy.
+    TuningResult
+    nelder_mead(
+      integer starts,                   //!< Number of starts
+      integer iterations,               //!< Maximum number of iterations per start
+      real    tolerance  = real(1e-6)   //!< Simplex size tolerance (normalised)
+    )
+    {
+      PIDDLE_ASSERT(starts > 0 && iterations >= 0,
+        "Piddle::Autotuner::nelder_mead(...): invalid number of starts or iterations.");
+      std::array<integer, DIMENSIONS> free;
+      integer dimensions = this->free_dimensions(free);
+
+      // Draw all start points on the calling thread
+      std::mt19937_64    generator(this->m_seed);
+      std::vector<Point> origins(static_cast<std::size_t>(starts));
+      origins[0] = this->normalise(this->project(this->m_controller.parameters()));
+      for (integer s = 1; s < starts; ++s)
+      {
+        origins[s] = origins[0];
+        for (integer i = 0; i < dimensions; ++i)
+          origins[s][free[i]] = real(generator() >> 11) * real(0x1.0p-53);
+      }
+
+      std::vector<TuningResult> results(static_cast<std::size_t>(starts));
+      this->workspaces(starts);
+      auto task = [this, &origins, &results, &free, dimensions, iterations, tolerance](integer s)
+      {
+        results[s] = this->simplex(s, origins[s], free, dimensions, iterations, tolerance);
+      };
+      this->m_pool.run(starts, task);
+
+      // Reduce in start order, so that ties are broken deterministically
+      TuningResult result = results[0];
+      for (integer s = 1; s < starts; ++s)
+      {
+        result.evaluations += results[s].evaluations;
+        if (results[s].metrics.cost < result.metrics.cost)
+        {
+          result.parameters = results[s].parameters;
+          result.metrics    = results[s].metrics;
+        }
+      }
+      return result;
+    }
+
+  private:
+    //! Get a parameter of a parameter set by index
+    static
+    real &
+    coordinate(
+      PIDParameters & parameters, //!< Parameter set
+      integer         i           //!< Parameter index
+    )
+    {
+      switch (i)
+      {
+        case 0:  return parameters.kp;
+        case 1:  return parameters.ki;
+        case 2:  return parameters.kd;
+        case 3:  return parameters.fc;
+        case 4:  return parameters.upper;
+        default: return parameters.lower;
+      }
+    }
+
+    //! Get the indices of the free parameters and their number
+    integer
+    free_dimensions(
+      std::array<integer, DIMENSIONS> & free //!< Free parameter indices
+    )
+    {
+      integer dimensions = 0;
+      for (integer i = 0; i < DIMENSIONS; ++i)
+        if (coordinate(this->m_bounds.lower, i) < coordinate(this->m_bounds.upper, i))
+          free[dimensions++] = i;
+      return dimensions;
+    }
+
+    //! Clamp a parameter set into the bounds
+    PIDParameters
+    project(
+      PIDParameters parameters //!< Parameter set
+    )
+    {
+      for (integer i = 0; i < DIMENSIONS; ++i)
+      {
+        real lo = coordinate(this->m_bounds.lower, i);
+        real hi = coordinate(this->m_bounds.upper, i);
+        real & x = coordinate(parameters, i);
+        x = lo == hi ? lo : std::min(std::max(x, lo), hi);
+      }
+      return parameters;
+    }
+
+    //! Map a parameter set to the unit box
+    Point
+    normalise(
+      PIDParameters parameters //!< Parameter set
+    )
+    {
+      Point point = {};
+      for (integer i = 0; i < DIMENSIONS; ++i)
+      {
+        real lo = coordinate(this->m_bounds.lower, i);
+        real hi = coordinate(this->m_bounds.upper, i);
+        if (lo < hi)
+          point[i] = (coordinate(parameters, i) - lo) / (hi - lo);
+      }
+      return point;
+    }
+
+    //! Map a unit box point to a parameter set
+    PIDParameters
+    denormalise(
+      Point const & point //!< Normalised point
+    )
+    {
+      PIDParameters parameters;
+      for (integer i = 0; i < DIMENSIONS; ++i)
+      {
+        real lo = coordinate(this->m_bounds.lower, i);
+        real hi = coordinate(this->m_bounds.upper, i);
+        coordinate(parameters, i) = lo == hi ? lo : lo + std::min(std::max(point[i], real(0.0)), real(1.0)) * (hi - lo);
+      }
+      return parameters;
+    }
+
+    //! Grow the per-task controller and plant copies
+    void
+    workspaces(
+      integer tasks //!< Number of tasks
+    )
+    {
+      while (integer(this->m_controllers.size()) < tasks)
+      {
+        this->m_controllers.push_back(this->m_controller);
+        this->m_plants.push_back(this->m_plant);
+      }
+    }
+
+    //! Score a parameter set on a task workspace
+    TuningMetrics
+    simulate(
+      integer               task,      //!< Task index
+      PIDParameters const & parameters //!< Parameter set
+    )
+    {
+      PID & controller = this->m_controllers[task];
+      controller.parameters(parameters);
+      return simulate_step_response(controller, this->m_plants[task], this->m_scenario, this->m_weights);
+    }
+
+    //! Run a Nelder-Mead search from a start point on a task workspace
+    //! (standard reflection, expansion, contraction and shrink coefficients)
+    TuningResult
+    simplex(
+      integer                                 task,       //!< Task index
+      Point const &                           origin,     //!< Start point
+      std::array<integer, DIMENSIONS> const & free,       //!< Free parameter indices
+      integer                                 dimensions, //!< Number of free parameters
+      integer                                 iterations, //!< Maximum number of iterations
+      real                                    tolerance   //!< Simplex size tolerance
+    )
+    {
+      TuningResult result;
+      auto score = [this, task, &result](Point & point)
+      {
+        for (real & x : point)
+          x = std::min(std::max(x, real(0.0)), real(1.0));
+        ++result.evaluations;
+        return this->simulate(task, this->denormalise(point)).cost;
+      };
+
+      // Initial simplex with steps pointing inside the unit box
+      std::array<Point, DIMENSIONS + 1> vertex;
+      std::array<real, DIMENSIONS + 1>  cost;
+      vertex[0] = origin;
+      cost[0]   = score(vertex[0]);
+      for (integer i = 0; i < dimensions; ++i)
+      {
+        vertex[i + 1] = origin;
+        real & x = vertex[i + 1][free[i]];
+        x += x > real(0.5) ? -real(0.1) : real(0.1);
+        cost[i + 1] = score(vertex[i + 1]);
+      }
+
+      integer count = dimensions + 1;
+      for (integer iteration = 0; iteration < iterations && dimensions > 0; ++iteration)
+      {
+        // Sort vertices by cost (insertion sort on at most seven vertices)
+        for (integer i = 1; i < count; ++i)
+          for (integer j = i; j > 0 && cost[j] < cost[j - 1]; --j)
+          {
+            std::swap(cost[j], cost[j - 1]);
+            std::swap(vertex[j], vertex[j - 1]);
+          }
+
+        // Stop once the simplex has collapsed
+        real size = real(0.0);
+        for (integer i = 1; i < count; ++i)
+          for (integer d = 0; d < dimensions; ++d)
+            size = std::max(size, std::abs(vertex[i][free[d]] - vertex[0][free[d]]));
+        if (size < tolerance)
+          break;
+
+        Point & worst = vertex[dimensions];
+        Point   centroid = vertex[0];
+        for (integer d = 0; d < dimensions; ++d)
+        {
+          real sum = real(0.0);
+          for (integer i = 0; i < dimensions; ++i)
+            sum += vertex[i][free[d]];
+          centroid[free[d]] = sum / real(dimensions);
+        }
+        auto blend = [&centroid, &worst, &free, dimensions](real t)
+        {
+          Point point = centroid;
+          for (integer d = 0; d < dimensions; ++d)
+            point[free[d]] += t * (worst[free[d]] - centroid[free[d]]);
+          return point;
+        };
+
+        Point reflected = blend(-real(1.0));
+        real  reflected_cost = score(reflected);
+        if (reflected_cost < cost[0])
+        {
+          Point expanded = blend(-real(2.0));
+          real  expanded_cost = score(expanded);
+          worst = expanded_cost < reflected_cost ? expanded : reflected;
+          cost[dimensions] = std::min(expanded_cost, reflected_cost);
+        }
+        else if (reflected_cost < cost[dimensions - 1])
+        {
+          worst = reflected;
+          cost[dimensions] = reflected_cost;
+        }
+        else
+        {
+          bool  outside = reflected_cost < cost[dimensions];
+          Point contracted = blend(outside ? -real(0.5) : real(0.5));
+          real  contracted_cost = score(contracted);
+          if (contracted_cost < std::min(reflected_cost, cost[dimensions]))
+          {
+            worst = contracted;
+            cost[dimensions] = contracted_cost;
+          }
+          else
+          {
+            // Shrink towards the best vertex
+            for (integer i = 1; i < count; ++i)
+            {
+              for (integer d = 0; d < dimensions; ++d)
+                vertex[i][free[d]] = vertex[0][free[d]] + real(0.5) * (vertex[i][free[d]] - vertex[0][free[d]]);
+              cost[i] = score(vertex[i]);
+            }
+          }
+        }
+      }
+
+      integer best = 0;
+      for (integer i = 1; i < count; ++i)
+        if (cost[i] < cost[best])
+          best = i;
+      result.parameters = this->denormalise(vertex[best]);
+      result.metrics    = this->simulate(task, result.parameters);
+      ++result.evaluations;
+      return result;
+    }
+
+  }; // class Autotuner
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Autotune.hh
+///
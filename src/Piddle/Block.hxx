@@ -27,9 +27,52 @@
 #ifndef INCLUDE_PIDDLE_BLOCK
 #define INCLUDE_PIDDLE_BLOCK
 
+#include "State.hxx"
+
+#include <memory>
+#include <span>
+
 namespace Piddle
 {
 
+  //! Check the sizes of the spans of a batch processing call. The time steps
+  //! span holds either a single fixed time step or one time step per sample.
+  template <typename Scalar>
+  void
+  check_batch(
+    std::span<Scalar const> input, //!< Input values
+    std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+    std::span<Scalar>       out,   //!< Output values
+    char const *            where  //!< Calling method name
+  )
+  {
+    PIDDLE_ASSERT(out.size() == input.size(),
+      "Piddle::" << where << "(...): output size " << out.size() << " does not match input size " << input.size() << ".");
+    PIDDLE_ASSERT(dt.size() == 1 || dt.size() == input.size(),
+      "Piddle::" << where << "(...): time steps size " << dt.size() << " is neither 1 nor the input size " << input.size() << ".");
+  }
+
+  //! Call a batch kernel with a time step accessor, so that the fixed and the
+  //! per-sample time step cases are compiled into separate loops
+  template <typename Scalar, typename Kernel>
+  void
+  with_time_steps(
+    std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+    Kernel &&               kernel //!< Kernel, called as kernel(time_step) with time_step(k) returning the k-th time step
+  )
+  {
+    if (dt.size() == 1)
+    {
+      Scalar fixed = dt[0];
+      kernel([fixed](std::size_t) {return fixed;});
+    }
+    else
+    {
+      Scalar const * steps = dt.data();
+      kernel([steps](std::size_t k) {return steps[k];});
+    }
+  }
+
   /*\
    |   ____  _            _
    |  | __ )| | ___   ___| | __
@@ -93,7 +136,7 @@ namespace Piddle
     void
     enable(void)
     {
-      this->m_enabled = false;
+      this->m_enabled = true;
     }
 
     //! Disable block
@@ -108,14 +151,170 @@ namespace Piddle
     setup(
       real input, //!< Input value
       real dt     //!< Time step
-    ) const = 0;
+    ) = 0;
+
+    //! Setup block over a batch of samples (the time steps span holds either a
+    //! single fixed time step or one time step per sample, and the output span
+    //! may alias the input span). Results match a loop of setup calls.
+    virtual void
+    process(
+      std::span<real const> input, //!< Input values
+      std::span<real const> dt,    //!< Time steps
+      std::span<real>       out    //!< Output values
+    )
+    {
+      check_batch(input, dt, out, "Block::process");
+      with_time_steps(dt, [&](auto time_step)
+      {
+        for (std::size_t k = 0; k < input.size(); ++k)
+          out[k] = this->setup(input[k], time_step(k));
+      });
+    }
 
     //! Reset block internal parameters
     virtual void
     reset(void) = 0;
 
+    //! Get a copy of the block, which owns its internal state (copies of
+    //! composite blocks must not share stateful sub-blocks)
+    virtual std::shared_ptr<Block>
+    clone(void) const = 0;
+
+    //! Save block state and parameters into a snapshot (blocks without
+    //! internal state only save their enabling state)
+    virtual void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      this->save_header(writer, STATE_BLOCK);
+    }
+
+    //! Restore block state and parameters from a snapshot
+    virtual void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      this->restore_header(reader, STATE_BLOCK);
+    }
+
+  protected:
+    //! Save the record tag and the enabling state of the block
+    void
+    save_header(
+      StateWriter & writer, //!< State writer
+      StateTag      tag     //!< Record tag
+    )
+    const
+    {
+      writer.write(std::uint8_t(tag));
+      writer.write(std::uint8_t(this->m_enabled ? 1 : 0));
+    }
+
+    //! Restore the record tag and the enabling state of the block
+    void
+    restore_header(
+      StateReader & reader, //!< State reader
+      StateTag      tag     //!< Record tag
+    )
+    {
+      reader.expect(tag);
+      this->m_enabled = reader.read<std::uint8_t>() != 0;
+    }
+
   }; // class Block
 
+  //! Class to wrap a static controller (e.g. BasicPID) into a block, so that
+  //! it can be used for runtime composition
+  template <typename Controller>
+  class BlockAdapter : public Block
+  {
+  public:
+    typedef typename Controller::scalar_type scalar_type; //!< Controller scalar number type
+
+  private:
+    Controller m_controller; //!< Wrapped static controller
+
+  public:
+    //! Class constructor
+    BlockAdapter(
+      Controller const & controller = Controller() //!< Static controller
+    )
+      : m_controller(controller)
+    {
+    }
+
+    //! Get wrapped controller const reference
+    Controller const &
+    controller(void) const
+    {
+      return this->m_controller;
+    }
+
+    //! Get wrapped controller reference
+    Controller &
+    controller(void)
+    {
+      return this->m_controller;
+    }
+
+    //! Setup wrapped controller and calculate output
+    real
+    setup(
+      real input, //!< Input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      if (this->is_enabled())
+        return static_cast<real>(this->m_controller.setup(scalar_type(input), scalar_type(dt)));
+      else
+        return real(0.0);
+    }
+
+    //! Reset wrapped controller
+    void
+    reset(void) override
+    {
+      this->m_controller.reset();
+    }
+
+    //! Get a copy of the adapter and of the wrapped controller
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<BlockAdapter>(*this);
+    }
+
+    //! Save wrapped controller state and parameters (only the enabling state
+    //! if the controller cannot be saved)
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_BLOCK);
+      if constexpr (requires {this->m_controller.save(writer);})
+        this->m_controller.save(writer);
+    }
+
+    //! Restore wrapped controller state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_BLOCK);
+      if constexpr (requires {this->m_controller.restore(reader);})
+        this->m_controller.restore(reader);
+    }
+
+  }; // class BlockAdapter
+
 } // namespace Piddle
 
 #endif
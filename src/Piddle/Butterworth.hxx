@@ -0,0 +1,468 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Butterworth.hh
+///
+
+#ifndef INCLUDE_PIDDLE_BUTTERWORTH
+#define INCLUDE_PIDDLE_BUTTERWORTH
+
+#include "Block.hxx"
+
+#include <array>
+
+namespace Piddle
+{
+
+  /*\
+   |   ____        _   _                                 _   _
+   |  | __ ) _   _| |_| |_  ___ _ ____      __ ___  _ __| |_| |__
+   |  |  _ \| | | | __| __|/ _ \ '__\ \ /\ / // _ \| '__| __| '_ \
+   |  | |_) | |_| | |_| |_|  __/ |   \ V  V /| (_) | |  | |_| | | |
+   |  |____/ \__,_|\__|\__|\___|_|    \_/\_/  \___/|_|   \__|_| |_|
+   |
+  \*/
+
+  //! Class to represent a second order section in transposed direct form II
+  template <typename Scalar>
+  class BasicBiquad
+  {
+  private:
+    Scalar m_b0 = Scalar(1.0); //!< Numerator coefficient of z^0
+    Scalar m_b1 = Scalar(0.0); //!< Numerator coefficient of z^-1
+    Scalar m_b2 = Scalar(0.0); //!< Numerator coefficient of z^-2
+    Scalar m_a1 = Scalar(0.0); //!< Denominator coefficient of z^-1
+    Scalar m_a2 = Scalar(0.0); //!< Denominator coefficient of z^-2
+    Scalar m_z1 = Scalar(0.0); //!< First delay state
+    Scalar m_z2 = Scalar(0.0); //!< Second delay state
+
+  public:
+    //! Set section coefficients (denominator normalized to a0 = 1)
+    void
+    coefficients(
+      Scalar b0, //!< Numerator coefficient of z^0
+      Scalar b1, //!< Numerator coefficient of z^-1
+      Scalar b2, //!< Numerator coefficient of z^-2
+      Scalar a1, //!< Denominator coefficient of z^-1
+      Scalar a2  //!< Denominator coefficient of z^-2
+    )
+    {
+      this->m_b0 = b0;
+      this->m_b1 = b1;
+      this->m_b2 = b2;
+      this->m_a1 = a1;
+      this->m_a2 = a2;
+    }
+
+    //! Setup section and calculate output
+    Scalar
+    setup(
+      Scalar input //!< Input value
+    )
+    {
+      Scalar output = this->m_b0 * input + this->m_z1;
+      this->m_z1 = this->m_b1 * input - this->m_a1 * output + this->m_z2;
+      this->m_z2 = this->m_b2 * input - this->m_a2 * output;
+      return output;
+    }
+
+    //! Setup section over a batch of samples (the output may alias the input)
+    void
+    process(
+      Scalar const * input, //!< Input values
+      Scalar *       out,   //!< Output values
+      std::size_t    size   //!< Number of samples
+    )
+    {
+      Scalar z1 = this->m_z1;
+      Scalar z2 = this->m_z2;
+      for (std::size_t k = 0; k < size; ++k)
+      {
+        Scalar x = input[k];
+        Scalar y = this->m_b0 * x + z1;
+        z1 = this->m_b1 * x - this->m_a1 * y + z2;
+        z2 = this->m_b2 * x - this->m_a2 * y;
+        out[k] = y;
+      }
+      this->m_z1 = z1;
+      this->m_z2 = z2;
+    }
+
+    //! Save section states
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_z1);
+      writer.write(this->m_z2);
+    }
+
+    //! Restore section states
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_z1);
+      reader.read(this->m_z2);
+    }
+
+    //! Reset section states
+    void
+    reset(void)
+    {
+      this->m_z1 = Scalar(0.0);
+      this->m_z2 = Scalar(0.0);
+    }
+
+  }; // class BasicBiquad
+
+  //! Class to represent a static Butterworth low-pass filter of order 2 to 8,
+  //! built as cascaded biquads (plus a first order section for odd orders).
+  //! Transformation done using the bilinear transform with frequency
+  //! prewarping. Coefficients are cached and recomputed only when the time
+  //! step or the cut-off frequency change. A non-positive cut-off frequency
+  //! disables the filter, which then holds its previous output (zero after a
+  //! reset) as the first order filter does.
+  template <typename Scalar>
+  class BasicButterworth
+  {
+  public:
+    static constexpr bool    ENABLED   = true; //!< Component presence flag
+    static constexpr integer MIN_ORDER = 2;    //!< Minimum filter order
+    static constexpr integer MAX_ORDER = 8;    //!< Maximum filter order
+
+  private:
+    std::array<BasicBiquad<Scalar>, (MAX_ORDER + 1) / 2> m_sections; //!< Cascaded sections
+
+    integer m_order;                 //!< Filter order
+    Scalar  m_cutoff_frequency;      //!< Cut-off frequency (Hz)
+    Scalar  m_output = Scalar(0.0);  //!< Previous output value
+    Scalar  m_dt     = Scalar(0.0);  //!< Time step of the cached coefficients
+    Scalar  m_fc     = Scalar(0.0);  //!< Cut-off frequency of the cached coefficients
+    bool    m_cached = false;        //!< Cached coefficients validity flag
+
+  public:
+    //! Class constructor
+    BasicButterworth(
+      integer order = 2,                    //!< Filter order
+      Scalar  cutoff_frequency = Scalar(0.0) //!< Cut-off frequency (Hz)
+    )
+      : m_order(order), m_cutoff_frequency(cutoff_frequency)
+    {
+      PIDDLE_ASSERT(order >= MIN_ORDER && order <= MAX_ORDER,
+        "Piddle::BasicButterworth(...): order " << order << " out of range [" << MIN_ORDER << "," << MAX_ORDER << "].");
+    }
+
+    //! Get filter order
+    integer
+    order(void) const
+    {
+      return this->m_order;
+    }
+
+    //! Get cut-off frequency const reference
+    Scalar const &
+    cutoff_frequency(void) const
+    {
+      return this->m_cutoff_frequency;
+    }
+
+    //! Get cut-off frequency reference
+    Scalar &
+    cutoff_frequency(void)
+    {
+      return this->m_cutoff_frequency;
+    }
+
+    //! Get output value const reference
+    Scalar const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Setup low-pass filter component
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar dt     //!< Time step
+    )
+    {
+      if (!(this->m_cutoff_frequency > Scalar(0.0)))
+        return this->m_output;
+      if (!this->m_cached || !(dt == this->m_dt) || !(this->m_cutoff_frequency == this->m_fc))
+        this->discretise(dt);
+      integer sections = (this->m_order + 1) / 2;
+      for (integer i = 0; i < sections; ++i)
+        input = this->m_sections[i].setup(input);
+      return this->m_output = input;
+    }
+
+    //! Setup low-pass filter component over a batch of samples (each run of
+    //! constant time step is filtered section by section, so that the inner
+    //! loops carry a single biquad recurrence)
+    void
+    process(
+      std::span<Scalar const> input, //!< Input values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    {
+      check_batch(input, dt, out, "BasicButterworth::process");
+      if (!(this->m_cutoff_frequency > Scalar(0.0)))
+      {
+        std::fill(out.begin(), out.end(), this->m_output);
+        return;
+      }
+      integer     sections = (this->m_order + 1) / 2;
+      std::size_t k        = 0;
+      while (k < input.size())
+      {
+        Scalar h = dt.size() == 1 ? dt[0] : dt[k];
+        if (!this->m_cached || !(h == this->m_dt) || !(this->m_cutoff_frequency == this->m_fc))
+          this->discretise(h);
+        std::size_t end = k + 1;
+        if (dt.size() == 1)
+          end = input.size();
+        else
+          while (end < input.size() && dt[end] == h)
+            ++end;
+        this->m_sections[0].process(input.data() + k, out.data() + k, end - k);
+        for (integer i = 1; i < sections; ++i)
+          this->m_sections[i].process(out.data() + k, out.data() + k, end - k);
+        k = end;
+      }
+      if (!input.empty())
+        this->m_output = out.back();
+    }
+
+    //! Save filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_order);
+      writer.write(this->m_cutoff_frequency);
+      writer.write(this->m_output);
+      integer sections = (this->m_order + 1) / 2;
+      for (integer i = 0; i < sections; ++i)
+        this->m_sections[i].save(writer);
+    }
+
+    //! Restore filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      integer order = reader.read<integer>();
+      PIDDLE_ASSERT(order == this->m_order,
+        "Piddle::BasicButterworth::restore(...): order " << order << " does not match " << this->m_order << ".");
+      reader.read(this->m_cutoff_frequency);
+      reader.read(this->m_output);
+      integer sections = (this->m_order + 1) / 2;
+      for (integer i = 0; i < sections; ++i)
+        this->m_sections[i].restore(reader);
+    }
+
+    //! Reset filter component
+    void
+    reset(void)
+    {
+      for (BasicBiquad<Scalar> & section : this->m_sections)
+        section.reset();
+      this->m_output = Scalar(0.0);
+    }
+
+  private:
+    //! Compute the discretised sections coefficients (evaluated in double
+    //! precision for any scalar type)
+    void
+    discretise(
+      Scalar dt //!< Time step
+    )
+    {
+      double fc = static_cast<double>(this->m_cutoff_frequency);
+      double ts = static_cast<double>(dt);
+      PIDDLE_ASSERT(fc * ts < 0.5,
+        "Piddle::BasicButterworth::setup(...): cut-off frequency " << fc << " Hz out of range (0," << 0.5 / ts << ") Hz.");
+
+      // Prewarped analog frequency
+      double k  = std::tan(PI * fc * ts);
+      double k2 = k * k;
+
+      // Complex conjugate pole pairs
+      integer pairs = this->m_order / 2;
+      for (integer i = 0; i < pairs; ++i)
+      {
+        double q    = 1.0 / (2.0 * std::sin(PI * double(2 * i + 1) / double(2 * this->m_order)));
+        double norm = 1.0 / (1.0 + k / q + k2);
+        double b0   = k2 * norm;
+        this->m_sections[i].coefficients(
+          Scalar(b0), Scalar(2.0 * b0), Scalar(b0),
+          Scalar(2.0 * (k2 - 1.0) * norm), Scalar((1.0 - k / q + k2) * norm)
+        );
+      }
+
+      // Real pole for odd orders
+      if (this->m_order % 2 == 1)
+      {
+        double norm = 1.0 / (1.0 + k);
+        this->m_sections[pairs].coefficients(
+          Scalar(k * norm), Scalar(k * norm), Scalar(0.0), Scalar((k - 1.0) * norm), Scalar(0.0)
+        );
+      }
+
+      this->m_dt     = dt;
+      this->m_fc     = this->m_cutoff_frequency;
+      this->m_cached = true;
+    }
+
+  }; // class BasicButterworth
+
+  //! Class to represent Butterworth low-pass filter of order 2 to 8
+  class Butterworth : public Block
+  {
+  private:
+    BasicButterworth<real> m_core; //!< Static Butterworth filter component
+
+  public:
+    //! Class constructor
+    Butterworth(
+      integer order = 2,                  //!< Filter order
+      real    cutoff_frequency = real(0.0) //!< Cut-off frequency (Hz)
+    )
+      : m_core(order, cutoff_frequency)
+    {
+    }
+
+    //! Get filter order
+    integer
+    order(void) const
+    {
+      return this->m_core.order();
+    }
+
+    //! Get cut-off frequency const reference
+    real const &
+    cutoff_frequency(void) const
+    {
+      return this->m_core.cutoff_frequency();
+    }
+
+    //! Get cut-off frequency reference
+    real &
+    cutoff_frequency(void)
+    {
+      return this->m_core.cutoff_frequency();
+    }
+
+    //! Get output value const reference
+    real const &
+    output(void) const
+    {
+      return this->m_core.output();
+    }
+
+    //! Setup low-pass filter component
+    real
+    setup(
+      real input, //!< Input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      if (this->is_enabled())
+        return this->m_core.setup(input, dt);
+      else
+        return real(0.0);
+    }
+
+    //! Setup low-pass filter component over a batch of samples
+    void
+    process(
+      std::span<real const> input, //!< Input values
+      std::span<real const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      if (this->is_enabled())
+        this->m_core.process(input, dt, out);
+      else
+      {
+        check_batch(input, dt, out, "Butterworth::process");
+        std::fill(out.begin(), out.end(), real(0.0));
+      }
+    }
+
+    //! Save filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_BUTTERWORTH);
+      this->m_core.save(writer);
+    }
+
+    //! Restore filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_BUTTERWORTH);
+      this->m_core.restore(reader);
+    }
+
+    //! Reset filter component
+    void
+    reset(void) override
+    {
+      this->m_core.reset();
+    }
+
+    //! Get a copy of the filter component (with its own section states)
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<Butterworth>(*this);
+    }
+
+  }; // class Butterworth
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Butterworth.hh
+///
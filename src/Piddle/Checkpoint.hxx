@@ -0,0 +1,411 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Checkpoint.hh
+///
+
+#ifndef INCLUDE_PIDDLE_CHECKPOINT
+#define INCLUDE_PIDDLE_CHECKPOINT
+
+#include "State.hxx"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Piddle
+{
+
+  /*\
+   |    ____ _               _                _       _
+   |   / ___| |__   ___  ___| | ___ __   ___ (_)_ __ | |_
+   |  | |   | '_ \ / _ \/ __| |/ / '_ \ / _ \| | '_ \| __|
+   |  | |___| | | |  __/ (__|   <| |_) | (_) | | | | | |_
+   |   \____|_| |_|\___|\___|_|\_\ .__/ \___/|_|_| |_|\__|
+   |                             |_|
+  \*/
+
+  //! Class to represent a memory-mapped state file with two alternating
+  //! snapshot slots. Each write goes to the slot that does not hold the latest
+  //! snapshot: the slot is invalidated, the payload and its size and checksum
+  //! are copied, and the sequence number is published last. A crash in the
+  //! middle of a write leaves a slot with a zero sequence or a wrong checksum,
+  //! so that the previous snapshot is still restored. Writes only touch the
+  //! page cache (a process crash is covered); a synchronous write also flushes
+  //! the slot to the storage device (a power loss is covered).
+  class CheckpointFile
+  {
+  public:
+    static constexpr std::size_t   CAPACITY = std::size_t(1) << 20; //!< Default slot capacity (bytes)
+    static constexpr std::uint32_t MAGIC    = 0x434C4450u;           //!< File magic number ("PDLC")
+    static constexpr std::uint16_t VERSION  = 1;                     //!< File layout version
+
+  private:
+    //! File header
+    struct FileHeader
+    {
+      std::uint32_t magic;    //!< File magic number
+      std::uint16_t version;  //!< File layout version
+      std::uint16_t reserved; //!< Reserved
+      std::uint64_t capacity; //!< Slot payload capacity (bytes)
+    };
+
+    //! Slot header
+    struct SlotHeader
+    {
+      std::uint64_t sequence; //!< Snapshot sequence number (zero if invalid)
+      std::uint64_t size;     //!< Snapshot size (bytes)
+      std::uint64_t checksum; //!< Snapshot checksum
+      std::uint64_t reserved; //!< Reserved
+    };
+
+    static constexpr std::size_t HEADER = 64; //!< File header stride (bytes)
+
+    std::uint8_t * m_map      = nullptr; //!< Mapped memory
+    std::size_t    m_bytes    = 0;       //!< Mapped size (bytes)
+    std::size_t    m_capacity = 0;       //!< Slot payload capacity (bytes)
+    std::size_t    m_stride   = 0;       //!< Slot stride (bytes)
+    std::uint64_t  m_sequence = 0;       //!< Latest valid sequence number
+
+  public:
+    //! Class constructor. A new (or empty) state file is created with the given
+    //! slot capacity, an existing state file keeps its layout. A non-empty file
+    //! that is not a state file of this version is rejected and left untouched.
+    CheckpointFile(
+      std::string const & path,                //!< State file path
+      std::size_t         capacity = CAPACITY  //!< Slot payload capacity (bytes) of new files
+    )
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+      PIDDLE_ASSERT(fd >= 0, "Piddle::CheckpointFile(...): cannot open file '" << path << "'.");
+      struct stat info;
+      FileHeader  header = {};
+      if (::fstat(fd, &info) != 0)
+      {
+        ::close(fd);
+        PIDDLE_ERROR("Piddle::CheckpointFile(...): cannot stat file '" << path << "'.");
+      }
+      if (info.st_size == 0)
+      {
+        header.magic    = MAGIC;
+        header.version  = VERSION;
+        header.reserved = 0;
+        header.capacity = std::uint64_t(capacity);
+        if (::ftruncate(fd, off_t(HEADER + 2 * stride(capacity))) != 0 ||
+            ::pwrite(fd, &header, sizeof(FileHeader), 0) != ssize_t(sizeof(FileHeader)))
+        {
+          ::close(fd);
+          PIDDLE_ERROR("Piddle::CheckpointFile(...): cannot initialise file '" << path << "'.");
+        }
+      }
+      else
+      {
+        bool read    = std::size_t(info.st_size) >= HEADER &&
+                       ::pread(fd, &header, sizeof(FileHeader), 0) == ssize_t(sizeof(FileHeader));
+        bool magic   = read && header.magic == MAGIC;
+        bool version = magic && header.version == VERSION;
+        bool size    = version && header.capacity <= std::uint64_t(info.st_size) &&
+                       std::size_t(info.st_size) == HEADER + 2 * stride(std::size_t(header.capacity));
+        if (!size)
+          ::close(fd);
+        PIDDLE_ASSERT(magic, "Piddle::CheckpointFile(...): '" << path << "' is not a state file.");
+        PIDDLE_ASSERT(version,
+          "Piddle::CheckpointFile(...): unsupported state file version " << header.version << " of '" << path << "'.");
+        PIDDLE_ASSERT(size, "Piddle::CheckpointFile(...): truncated or corrupted state file '" << path << "'.");
+      }
+      this->m_capacity = std::size_t(header.capacity);
+      this->m_stride   = stride(this->m_capacity);
+      this->m_bytes    = HEADER + 2 * this->m_stride;
+      void * map = ::mmap(nullptr, this->m_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      PIDDLE_ASSERT(map != MAP_FAILED, "Piddle::CheckpointFile(...): cannot map file '" << path << "'.");
+      this->m_map = static_cast<std::uint8_t *>(map);
+      for (integer i = 0; i < 2; ++i)
+        if (this->valid(i))
+          this->m_sequence = std::max(this->m_sequence, this->slot(i)->sequence);
+#else
+      PIDDLE_ERROR("Piddle::CheckpointFile(...): memory-mapped state files are not supported on this platform.");
+#endif
+    }
+
+    //! Class destructor (unmaps the file)
+    ~CheckpointFile(void)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      if (this->m_map != nullptr)
+        ::munmap(this->m_map, this->m_bytes);
+#endif
+    }
+
+    //! Deleted copy constructor
+    CheckpointFile(CheckpointFile const &) = delete;
+
+    //! Deleted copy assignment operator
+    CheckpointFile & operator=(CheckpointFile const &) = delete;
+
+    //! Get the slot payload capacity (bytes)
+    std::size_t
+    capacity(void) const
+    {
+      return this->m_capacity;
+    }
+
+    //! Get the latest valid sequence number (zero if no snapshot was written)
+    std::uint64_t
+    sequence(void) const
+    {
+      return this->m_sequence;
+    }
+
+    //! Write a snapshot into the older slot
+    void
+    write(
+      std::span<std::uint8_t const> data,        //!< Snapshot bytes
+      bool                          sync = false //!< Flush the slot to the storage device
+    )
+    {
+      PIDDLE_ASSERT(data.size() <= this->m_capacity,
+        "Piddle::CheckpointFile::write(...): snapshot size " << data.size() << " exceeds the slot capacity " << this->m_capacity << ".");
+      std::uint64_t sequence = this->m_sequence + 1;
+      integer       index    = integer(sequence & 1);
+      SlotHeader *  header   = this->slot(index);
+      std::atomic_ref<std::uint64_t>(header->sequence).store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      if (!data.empty())
+        std::memcpy(this->payload(index), data.data(), data.size());
+      header->size     = std::uint64_t(data.size());
+      header->checksum = state_checksum(data, sequence ^ header->size);
+      std::atomic_ref<std::uint64_t>(header->sequence).store(sequence, std::memory_order_release);
+#if defined(__unix__) || defined(__APPLE__)
+      if (sync)
+      {
+        // Flush the page-aligned slot range
+        std::size_t page  = std::size_t(::sysconf(_SC_PAGESIZE));
+        std::size_t begin = (HEADER + std::size_t(index) * this->m_stride) / page * page;
+        std::size_t end   = HEADER + std::size_t(index) * this->m_stride + sizeof(SlotHeader) + data.size();
+        PIDDLE_ASSERT(::msync(this->m_map + begin, end - begin, MS_SYNC) == 0,
+          "Piddle::CheckpointFile::write(...): cannot flush the state file.");
+      }
+#endif
+      this->m_sequence = sequence;
+    }
+
+    //! Get the latest valid snapshot in place (empty if none), falling back to
+    //! the other slot if the newest one is torn or corrupted. The bytes are
+    //! valid until the next write.
+    std::span<std::uint8_t const>
+    latest(void) const
+    {
+      integer newest = -1;
+      for (integer i = 0; i < 2; ++i)
+        if (this->valid(i) && (newest < 0 || this->slot(i)->sequence > this->slot(newest)->sequence))
+          newest = i;
+      if (newest < 0)
+        return std::span<std::uint8_t const>();
+      return std::span<std::uint8_t const>(this->payload(newest), std::size_t(this->slot(newest)->size));
+    }
+
+  private:
+    //! Get the slot stride for a payload capacity (cache line aligned)
+    static
+    std::size_t
+    stride(
+      std::size_t capacity //!< Slot payload capacity (bytes)
+    )
+    {
+      return (sizeof(SlotHeader) + capacity + 63) / 64 * 64;
+    }
+
+    //! Get a slot header address
+    SlotHeader *
+    slot(
+      integer i //!< Slot index
+    )
+    const
+    {
+      return reinterpret_cast<SlotHeader *>(this->m_map + HEADER + std::size_t(i) * this->m_stride);
+    }
+
+    //! Get a slot payload address
+    std::uint8_t *
+    payload(
+      integer i //!< Slot index
+    )
+    const
+    {
+      return this->m_map + HEADER + std::size_t(i) * this->m_stride + sizeof(SlotHeader);
+    }
+
+    //! Check a slot sequence number, size and checksum
+    bool
+    valid(
+      integer i //!< Slot index
+    )
+    const
+    {
+      SlotHeader const * header   = this->slot(i);
+      std::uint64_t      sequence = std::atomic_ref<std::uint64_t>(this->slot(i)->sequence).load(std::memory_order_acquire);
+      if (sequence == 0 || header->size > this->m_capacity)
+        return false;
+      std::span<std::uint8_t const> data(this->payload(i), std::size_t(header->size));
+      return state_checksum(data, sequence ^ header->size) == header->checksum;
+    }
+
+  }; // class CheckpointFile
+
+  //! Class to represent a checkpoint of a set of objects (blocks, pid banks,
+  //! executors or any object with save and restore methods) into a state
+  //! file. A snapshot of all the objects is rebuilt in a reused buffer at each
+  //! save, so that saving every cycle does not allocate. Objects are saved and
+  //! restored in registration order, and must outlive the checkpoint.
+  class Checkpoint
+  {
+  private:
+    typedef void (*Saver)(void const * object, StateWriter & writer);    //!< Type-erased save function
+    typedef void (*Restorer)(void * object, StateReader & reader);       //!< Type-erased restore function
+
+    //! Registered object
+    struct Entry
+    {
+      void *   object;  //!< Object address
+      Saver    save;    //!< Save function
+      Restorer restore; //!< Restore function
+    };
+
+    CheckpointFile     m_file;    //!< State file
+    StateWriter        m_writer;  //!< Snapshot writer
+    std::vector<Entry> m_entries; //!< Registered objects
+
+  public:
+    //! Class constructor
+    Checkpoint(
+      std::string const & path,                               //!< State file path
+      std::size_t         capacity = CheckpointFile::CAPACITY //!< Slot payload capacity (bytes) of new files
+    )
+      : m_file(path, capacity), m_writer(capacity)
+    {
+    }
+
+    //! Get state file reference
+    CheckpointFile &
+    file(void)
+    {
+      return this->m_file;
+    }
+
+    //! Get the number of registered objects
+    integer
+    size(void) const
+    {
+      return integer(this->m_entries.size());
+    }
+
+    //! Register an object
+    template <typename Object>
+    void
+    add(
+      Object & object //!< Object with save and restore methods
+    )
+    {
+      this->m_entries.push_back(Entry{
+        &object,
+        [](void const * o, StateWriter & writer) {static_cast<Object const *>(o)->save(writer);},
+        [](void * o, StateReader & reader) {static_cast<Object *>(o)->restore(reader);}
+      });
+    }
+
+    //! Save a snapshot of all the registered objects and get its size (bytes)
+    std::size_t
+    save(
+      bool sync = false //!< Flush the snapshot to the storage device
+    )
+    {
+      this->m_writer.clear();
+      this->m_writer.header(std::uint32_t(this->m_entries.size()));
+      for (Entry const & entry : this->m_entries)
+        entry.save(entry.object, this->m_writer);
+      this->m_file.write(this->m_writer.data(), sync);
+      return this->m_writer.size();
+    }
+
+    //! Restore all the registered objects from the latest valid snapshot.
+    //! Return false if the state file holds no valid snapshot, and throw if
+    //! the snapshot does not match the registered objects. The current states
+    //! are saved beforehand, so that a rejected snapshot leaves every object
+    //! as it was before the call (and not partially restored).
+    bool
+    restore(void)
+    {
+      std::span<std::uint8_t const> data = this->m_file.latest();
+      if (data.empty())
+        return false;
+      this->m_writer.clear();
+      this->m_writer.header(std::uint32_t(this->m_entries.size()));
+      for (Entry const & entry : this->m_entries)
+        entry.save(entry.object, this->m_writer);
+      try
+      {
+        this->load(data);
+      }
+      catch (...)
+      {
+        this->load(this->m_writer.data());
+        throw;
+      }
+      return true;
+    }
+
+  private:
+    //! Restore all the registered objects from a snapshot
+    void
+    load(
+      std::span<std::uint8_t const> data //!< Snapshot bytes
+    )
+    {
+      StateReader   reader(data);
+      std::uint32_t records = reader.header();
+      PIDDLE_ASSERT(records == this->m_entries.size(),
+        "Piddle::Checkpoint::restore(...): " << records << " saved objects for " << this->m_entries.size() << " registered objects.");
+      for (Entry const & entry : this->m_entries)
+        entry.restore(entry.object, reader);
+      PIDDLE_ASSERT(reader.remaining() == 0,
+        "Piddle::Checkpoint::restore(...): " << reader.remaining() << " trailing snapshot bytes.");
+    }
+
+  }; // class Checkpoint
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Checkpoint.hh
+///
@@ -42,13 +42,202 @@ namespace Piddle
    |
   \*/
 
+  //! Class to represent a static derivative component with output filter
+  template <typename Scalar, typename FilterType = NoFilter<Scalar>>
+  class BasicDerivative
+  {
+  private:
+    FilterType m_filter;                  //!< Derivative output block low-pass filter
+    Scalar     m_gain;                    //!< Derivative gain coefficient
+    Scalar     m_error_old = Scalar(0.0); //!< Previous error value
+
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+    //! Class constructor
+    BasicDerivative(
+      Scalar     gain = Scalar(1.0),       //!< Derivative gain coefficient
+      FilterType filter = FilterType()     //!< Derivative output block low-pass filter
+    )
+      : m_filter(filter), m_gain(gain)
+    {
+    }
+
+    //! Get derivative gain const reference
+    Scalar const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get derivative gain reference
+    Scalar &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Get previous error value const reference
+    Scalar const &
+    error(void) const
+    {
+      return this->m_error_old;
+    }
+
+    //! Get previous error value reference
+    Scalar &
+    error(void)
+    {
+      return this->m_error_old;
+    }
+
+    //! Get derivative output low-pass filter const reference
+    FilterType const &
+    filter(void) const
+    {
+      return this->m_filter;
+    }
+
+    //! Get derivative output low-pass filter reference
+    FilterType &
+    filter(void)
+    {
+      return this->m_filter;
+    }
+
+    //! Setup derivative component
+    Scalar
+    setup(
+      Scalar error, //!< Input error value
+      Scalar dt     //!< Time step
+    )
+    {
+      return this->m_gain * this->m_filter.setup(this->differentiate(error, dt), dt);
+    }
+
+    //! Get unfiltered error derivative through backward Euler formula
+    Scalar
+    differentiate(
+      Scalar error, //!< Input error value
+      Scalar dt     //!< Time step
+    )
+    {
+      Scalar diff = (error - this->m_error_old) / dt;
+      this->m_error_old = error;
+      return diff;
+    }
+
+    //! Get unfiltered error derivatives of a batch of samples through backward
+    //! Euler formula (stateless differences, vectorisable backward loop that
+    //! is also safe when the output span aliases the input span)
+    void
+    differentiate(
+      std::span<Scalar const> error, //!< Input error values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    {
+      check_batch(error, dt, out, "BasicDerivative::differentiate");
+      std::size_t n = error.size();
+      if (n == 0)
+        return;
+      Scalar const * input  = error.data();
+      Scalar *       output = out.data();
+      Scalar         last   = input[n - 1];
+      Scalar         first  = input[0];
+      with_time_steps(dt, [&](auto time_step)
+      {
+        for (std::size_t k = n - 1; k > 0; --k)
+          output[k] = (input[k] - input[k - 1]) / time_step(k);
+        output[0] = (first - this->m_error_old) / time_step(0);
+      });
+      this->m_error_old = last;
+    }
+
+    //! Setup derivative component over a batch of samples
+    void
+    process(
+      std::span<Scalar const> error, //!< Input error values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    {
+      this->differentiate(error, dt, out);
+      this->m_filter.process(std::span<Scalar const>(out), dt, out);
+      Scalar const gain   = this->m_gain;
+      Scalar *     output = out.data();
+      for (std::size_t k = 0; k < out.size(); ++k)
+        output[k] = gain * output[k];
+    }
+
+    //! Save derivative component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_gain);
+      writer.write(this->m_error_old);
+      if constexpr (FilterType::ENABLED)
+        this->m_filter.save(writer);
+    }
+
+    //! Restore derivative component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_gain);
+      reader.read(this->m_error_old);
+      if constexpr (FilterType::ENABLED)
+        this->m_filter.restore(reader);
+    }
+
+    //! Reset derivative component
+    void
+    reset(void)
+    {
+      this->m_error_old = Scalar(0.0);
+      this->m_filter.reset();
+    }
+
+  }; // class BasicDerivative
+
+  //! Class to represent a removed static derivative component
+  template <typename Scalar>
+  class NoDerivative
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Component presence flag
+
+    //! Setup derivative component
+    Scalar
+    setup(
+      Scalar, //!< Input error value
+      Scalar  //!< Time step
+    )
+    const
+    {
+      return Scalar(0.0);
+    }
+
+    //! Reset derivative component
+    void
+    reset(void)
+    {
+    }
+
+  }; // class NoDerivative
+
   //! Class to represent derivative component
   class Derivative : public Block
   {
   private:
-    filter m_filter;                //!< Derivative output block low-pass filter
-    real   m_gain;                  //!< Derivative gain coefficient
-    real   m_error_old = real(0.0); //!< Previous error value
+    Filter                                m_filter;        //!< Derivative output block low-pass filter
+    std::shared_ptr<Block>                m_custom_filter; //!< Derivative output block custom filter
+    BasicDerivative<real, NoFilter<real>> m_core;          //!< Static unfiltered derivative component
 
   public:
     //! Class constructor
@@ -56,26 +245,103 @@ namespace Piddle
       real gain = real(1.0), //!< Derivative gain coefficient
       real fc = real(0.0)    //!< Derivative output block low-pass filter cutoff frequency
     )
-      : m_gain(gain)
+      : m_filter(fc), m_core(gain)
+    {
+      // A null cutoff frequency means no derivative filtering
+      if (!(fc > real(0.0)))
+        this->m_filter.disable();
+    }
+
+    //! Class copy constructor (the custom filter is cloned, so that the copies
+    //! do not step each other's filter state)
+    Derivative(
+      Derivative const & other //!< Derivative component
+    )
+      : Block(other), m_filter(other.m_filter),
+        m_custom_filter(other.m_custom_filter ? other.m_custom_filter->clone() : nullptr), m_core(other.m_core)
     {
-      this->m_filter.cutoff_frequency(fc);
     }
 
-    //! Class destructor
+    //! Class move constructor
+    Derivative(Derivative &&) = default;
+
+    //! Copy assignment operator (the custom filter is cloned)
+    Derivative &
+    operator=(
+      Derivative const & other //!< Derivative component
+    )
+    {
+      if (this != &other)
+      {
+        Block::operator=(other);
+        this->m_filter        = other.m_filter;
+        this->m_custom_filter = other.m_custom_filter ? other.m_custom_filter->clone() : nullptr;
+        this->m_core          = other.m_core;
+      }
+      return *this;
+    }
 
+    //! Move assignment operator
+    Derivative & operator=(Derivative &&) = default;
 
     //! Get derivative gain const reference
     real const &
     gain(void) const
     {
-      return this->m_gain;
+      return this->m_core.gain();
     }
 
     //! Get derivative gain reference
     real &
     gain(void)
     {
-      return this->m_gain;
+      return this->m_core.gain();
+    }
+
+    //! Get derivative output low-pass filter const reference
+    Filter const &
+    filter(void) const
+    {
+      return this->m_filter;
+    }
+
+    //! Get derivative output low-pass filter reference
+    Filter &
+    filter(void)
+    {
+      return this->m_filter;
+    }
+
+    //! Get derivative output custom filter block (null if the first order
+    //! low-pass filter is used)
+    std::shared_ptr<Block> const &
+    custom_filter(void) const
+    {
+      return this->m_custom_filter;
+    }
+
+    //! Set derivative output custom filter block (e.g. Butterworth or
+    //! MovingAverage), a null pointer restores the first order low-pass filter
+    void
+    custom_filter(
+      std::shared_ptr<Block> filter //!< Custom filter block
+    )
+    {
+      this->m_custom_filter = std::move(filter);
+    }
+
+    //! Get previous error value const reference
+    real const &
+    error(void) const
+    {
+      return this->m_core.error();
+    }
+
+    //! Get previous error value reference
+    real &
+    error(void)
+    {
+      return this->m_core.error();
     }
 
     //! Setup derivative component
@@ -84,22 +350,99 @@ namespace Piddle
       real error, //!< Input error value
       real dt     //!< Time step
     )
-    const override
+    override
     {
       if (this->is_enabled())
-        return this->m_gain * this->differentiate(error, dt);
+        return this->m_core.gain() * this->differentiate(error, dt);
       else
         return real(0.0);
     }
 
+    //! Setup derivative component over a batch of samples
+    void
+    process(
+      std::span<real const> error, //!< Input error values
+      std::span<real const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      if (this->is_disabled())
+      {
+        check_batch(error, dt, out, "Derivative::process");
+        std::fill(out.begin(), out.end(), real(0.0));
+        return;
+      }
+
+      // Calculate derivatives
+      this->m_core.differentiate(error, dt, out);
+
+      // Perform derivative filtering
+      if (this->m_custom_filter)
+      {
+        if (this->m_custom_filter->is_enabled())
+          this->m_custom_filter->process(std::span<real const>(out), dt, out);
+      }
+      else if (this->m_filter.is_enabled())
+      {
+        this->m_filter.process(std::span<real const>(out), dt, out);
+      }
+
+      real const gain   = this->m_core.gain();
+      real *     output = out.data();
+      for (std::size_t k = 0; k < out.size(); ++k)
+        output[k] = gain * output[k];
+    }
+
+    //! Save derivative component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_DERIVATIVE);
+      this->m_core.save(writer);
+      this->m_filter.save(writer);
+      writer.write(std::uint8_t(this->m_custom_filter ? 1 : 0));
+      if (this->m_custom_filter)
+        this->m_custom_filter->save(writer);
+    }
+
+    //! Restore derivative component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_DERIVATIVE);
+      this->m_core.restore(reader);
+      this->m_filter.restore(reader);
+      bool custom = reader.read<std::uint8_t>() != 0;
+      PIDDLE_ASSERT(custom == bool(this->m_custom_filter),
+        "Piddle::Derivative::restore(...): custom filter presence mismatch.");
+      if (this->m_custom_filter)
+        this->m_custom_filter->restore(reader);
+    }
+
     //! Reset derivative component
     void
     reset(void) override
     {
-      this->m_old = real(0.0);
+      this->m_core.reset();
       this->m_filter.reset();
+      if (this->m_custom_filter)
+        this->m_custom_filter->reset();
     };
 
+    //! Get a copy of the derivative component (custom filter included)
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<Derivative>(*this);
+    }
+
   private:
     //! Get error derivative through backward Euler formula
     real
@@ -109,15 +452,19 @@ namespace Piddle
     )
     {
       // Calculate derivative
-      real diff = (error - this->m_error_old) / dt;
+      real diff = this->m_core.differentiate(error, dt);
 
       // Perform derivative filtering
-      if (this->m_filter.is_enabled())
+      if (this->m_custom_filter)
+      {
+        if (this->m_custom_filter->is_enabled())
+          diff = this->m_custom_filter->setup(diff, dt);
+      }
+      else if (this->m_filter.is_enabled())
       {
         diff = this->m_filter.setup(diff, dt);
       }
 
-      this->m_error_old = error;
       return diff;
     }
 
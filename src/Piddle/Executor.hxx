@@ -0,0 +1,531 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Executor.hh
+///
+
+#ifndef INCLUDE_PIDDLE_EXECUTOR
+#define INCLUDE_PIDDLE_EXECUTOR
+
+#include "Block.hxx"
+#include "ThreadPool.hxx"
+
+#include <chrono>
+#include <functional>
+#include <unordered_set>
+
+namespace Piddle
+{
+
+  /*\
+   |   _____                      _
+   |  | ____|_  __ ___  ___ _   _| |_  ___  _ __
+   |  |  _| \ \/ // _ \/ __| | | | __|/ _ \| '__|
+   |  | |___ >  <|  __/ (__| |_| | |_| (_) | |
+   |  |_____/_/\_\\___|\___|\__,_|\__|\___/|_|
+   |
+  \*/
+
+  //! Class to represent a multi-rate executor of controller fleets. Blocks are
+  //! registered into groups with a period, an input source and an output
+  //! sink. Groups with the same period form a rate class; at each release of
+  //! a rate class its groups are spread across a work-stealing thread pool.
+  //! In real time, every rate class is released by its own dispatcher thread
+  //! and owns a share of the worker threads (on disjoint cores when pinned),
+  //! so that a slow rate class does not delay the releases of the others, and
+  //! its jitter and deadline misses reflect its own load. In simulated time,
+  //! the rate classes are run one at a time on a single pool of all workers.
+  //! A group is run by a single thread, the blocks of a group are run in
+  //! registration order, and a rate class tick completes before its next
+  //! release is dispatched, so that a block never runs concurrently with
+  //! itself. A block can be registered only once.
+  class ControllerExecutor
+  {
+  public:
+    typedef std::function<real(void)> Input;  //!< Block input source type
+    typedef std::function<void(real)> Output; //!< Block output sink type
+
+    //! Rate class statistics (times in seconds)
+    struct Statistics
+    {
+      real          period          = real(0.0); //!< Rate class period
+      integer       groups          = 0;         //!< Number of groups
+      std::uint64_t ticks           = 0;         //!< Number of ticks
+      std::uint64_t deadline_misses = 0;         //!< Number of ticks completed after the next release
+      real          jitter_mean     = real(0.0); //!< Mean release lateness
+      real          jitter_max      = real(0.0); //!< Maximum release lateness
+      real          execution_max   = real(0.0); //!< Maximum tick execution time
+    };
+
+  private:
+    typedef std::chrono::steady_clock clock;    //!< Executor clock type
+    typedef std::int64_t              nanoseconds; //!< Executor time type
+
+    //! Registered block with its input source and output sink
+    struct Loop
+    {
+      std::shared_ptr<Block> block;  //!< Controller block
+      Input                  input;  //!< Input source
+      Output                 output; //!< Output sink (optional)
+    };
+
+    //! Group of loops run sequentially by a single thread
+    struct Group
+    {
+      real              period; //!< Group period
+      std::vector<Loop> loops;  //!< Group loops
+    };
+
+    //! Rate class of groups sharing the same period
+    struct RateClass
+    {
+      real                        period;             //!< Rate class period
+      nanoseconds                 period_ns;          //!< Rate class period in nanoseconds
+      std::vector<Group *>        groups;             //!< Rate class groups
+      std::atomic<std::uint64_t>  ticks{0};           //!< Number of ticks
+      std::atomic<std::uint64_t>  deadline_misses{0}; //!< Number of deadline misses
+      std::atomic<nanoseconds>    jitter_sum{0};      //!< Sum of release latenesses
+      std::atomic<nanoseconds>    jitter_max{0};      //!< Maximum release lateness
+      std::atomic<nanoseconds>    execution_max{0};   //!< Maximum tick execution time
+      ThreadPool *                pool = nullptr;     //!< Work-stealing thread pool running the ticks
+    };
+
+    integer                                  m_threads;         //!< Total number of worker threads
+    bool                                     m_pin;             //!< Pin workers to cores flag
+    bool                                     m_shared = false;  //!< Single pool shared by all rate classes flag
+    std::vector<std::unique_ptr<ThreadPool>> m_pools;           //!< Worker thread pools
+    std::vector<std::unique_ptr<Group>>     m_groups;          //!< Registered groups
+    std::vector<std::unique_ptr<RateClass>> m_classes;         //!< Rate classes sorted by period
+    std::unordered_set<Block const *>       m_blocks;          //!< Registered blocks
+    std::vector<std::thread>                m_dispatchers;     //!< Background dispatcher threads
+    std::atomic<bool>                       m_stop{false};     //!< Stop request flag
+    bool                                    m_running = false; //!< Running state flag
+
+  public:
+    //! Class constructor. In real time the worker threads are split evenly
+    //! across the rate classes (the remainder goes to the fastest ones), and
+    //! pinned workers of different rate classes get consecutive, disjoint
+    //! cores. A rate class without workers runs its ticks on its dispatcher.
+    ControllerExecutor(
+      integer threads = hardware_threads(), //!< Total number of worker threads
+      bool    pin     = false               //!< Pin workers to cores (Linux only)
+    )
+      : m_threads(threads), m_pin(pin)
+    {
+      PIDDLE_ASSERT(threads >= 0,
+        "Piddle::ControllerExecutor::ControllerExecutor(...): negative number of threads " << threads << ".");
+    }
+
+    //! Class destructor
+    ~ControllerExecutor(void)
+    {
+      this->stop();
+    }
+
+    //! Get the total number of worker threads
+    integer
+    threads(void) const
+    {
+      return this->m_threads;
+    }
+
+    //! Get the number of worker threads of a rate class in real time
+    integer
+    threads(
+      integer index //!< Rate class index
+    ) const
+    {
+      PIDDLE_ASSERT(index >= 0 && index < this->rate_classes(),
+        "Piddle::ControllerExecutor::threads(...): rate class index " << index << " out of range.");
+      integer classes = this->rate_classes();
+      return this->m_threads / classes + (index < this->m_threads % classes ? 1 : 0);
+    }
+
+    //! Create an empty group with the given period and return its index
+    integer
+    group(
+      real period //!< Group period (s)
+    )
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::group(...): executor is running.");
+      PIDDLE_ASSERT(period > real(0.0), "Piddle::ControllerExecutor::group(...): non-positive period " << period << ".");
+      this->m_groups.emplace_back(new Group{period, {}});
+      this->classify(this->m_groups.back().get());
+      return integer(this->m_groups.size()) - 1;
+    }
+
+    //! Register a block into an existing group
+    void
+    add(
+      integer                group,               //!< Group index
+      std::shared_ptr<Block> block,               //!< Controller block
+      Input                  input,               //!< Input source
+      Output                 output = Output()    //!< Output sink
+    )
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::add(...): executor is running.");
+      PIDDLE_ASSERT(group >= 0 && group < integer(this->m_groups.size()),
+        "Piddle::ControllerExecutor::add(...): group index " << group << " out of range.");
+      PIDDLE_ASSERT(block, "Piddle::ControllerExecutor::add(...): null block.");
+      PIDDLE_ASSERT(input, "Piddle::ControllerExecutor::add(...): empty input source.");
+      PIDDLE_ASSERT(this->m_blocks.insert(block.get()).second,
+        "Piddle::ControllerExecutor::add(...): block already registered.");
+      this->m_groups[group]->loops.push_back(Loop{std::move(block), std::move(input), std::move(output)});
+    }
+
+    //! Register a block into a new group and return the group index
+    integer
+    add(
+      std::shared_ptr<Block> block,            //!< Controller block
+      real                   period,           //!< Block period (s)
+      Input                  input,            //!< Input source
+      Output                 output = Output() //!< Output sink
+    )
+    {
+      integer index = this->group(period);
+      this->add(index, std::move(block), std::move(input), std::move(output));
+      return index;
+    }
+
+    //! Get the number of rate classes
+    integer
+    rate_classes(void) const
+    {
+      return integer(this->m_classes.size());
+    }
+
+    //! Get rate class statistics (rate classes are sorted by period)
+    Statistics
+    statistics(
+      integer index //!< Rate class index
+    ) const
+    {
+      PIDDLE_ASSERT(index >= 0 && index < this->rate_classes(),
+        "Piddle::ControllerExecutor::statistics(...): rate class index " << index << " out of range.");
+      RateClass const & rate = *this->m_classes[index];
+      Statistics out;
+      out.period          = rate.period;
+      out.groups          = integer(rate.groups.size());
+      out.ticks           = rate.ticks.load(std::memory_order_relaxed);
+      out.deadline_misses = rate.deadline_misses.load(std::memory_order_relaxed);
+      out.jitter_max      = real(rate.jitter_max.load(std::memory_order_relaxed)) * real(1.0e-9);
+      out.execution_max   = real(rate.execution_max.load(std::memory_order_relaxed)) * real(1.0e-9);
+      if (out.ticks > 0)
+        out.jitter_mean = real(rate.jitter_sum.load(std::memory_order_relaxed)) * real(1.0e-9) / real(out.ticks);
+      return out;
+    }
+
+    //! Reset all rate classes statistics
+    void
+    reset_statistics(void)
+    {
+      for (std::unique_ptr<RateClass> & rate : this->m_classes)
+      {
+        rate->ticks           = 0;
+        rate->deadline_misses = 0;
+        rate->jitter_sum      = 0;
+        rate->jitter_max      = 0;
+        rate->execution_max   = 0;
+      }
+    }
+
+    //! Reset all registered blocks (executor must not be running)
+    void
+    reset(void)
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::reset(...): executor is running.");
+      for (std::unique_ptr<Group> & group : this->m_groups)
+        for (Loop & loop : group->loops)
+          loop.block->reset();
+    }
+
+    //! Save all registered blocks states in registration order (executor must
+    //! not be running)
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::save(...): executor is running.");
+      writer.write(std::uint64_t(this->m_blocks.size()));
+      for (std::unique_ptr<Group> const & group : this->m_groups)
+        for (Loop const & loop : group->loops)
+          loop.block->save(writer);
+    }
+
+    //! Restore all registered blocks states in registration order (executor
+    //! must not be running)
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::restore(...): executor is running.");
+      std::uint64_t blocks = reader.read<std::uint64_t>();
+      PIDDLE_ASSERT(blocks == this->m_blocks.size(),
+        "Piddle::ControllerExecutor::restore(...): " << blocks << " saved blocks for " << this->m_blocks.size() << " registered blocks.");
+      for (std::unique_ptr<Group> & group : this->m_groups)
+        for (Loop & loop : group->loops)
+          loop.block->restore(reader);
+    }
+
+    //! Start running the rate classes in real time on background threads
+    void
+    start(void)
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::start(...): executor is already running.");
+      this->m_running = true;
+      this->m_stop    = false;
+      this->allocate(false);
+      this->launch(INFTY);
+    }
+
+    //! Stop the background real-time run (the current ticks are completed)
+    void
+    stop(void)
+    {
+      this->m_stop = true;
+      for (std::thread & dispatcher : this->m_dispatchers)
+        dispatcher.join();
+      this->m_dispatchers.clear();
+      this->m_running = false;
+    }
+
+    //! Run the rate classes in real time for the given duration (blocking)
+    void
+    run(
+      real duration //!< Run duration (s)
+    )
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::run(...): executor is already running.");
+      this->m_running = true;
+      this->m_stop    = false;
+      this->allocate(false);
+      this->launch(duration);
+      for (std::thread & dispatcher : this->m_dispatchers)
+        dispatcher.join();
+      this->m_dispatchers.clear();
+      this->m_running = false;
+    }
+
+    //! Run all the rate class ticks of the given simulated duration as fast as
+    //! possible (no sleeping, jitter is not recorded and a deadline is missed
+    //! when a tick execution time exceeds the rate class period)
+    void
+    simulate(
+      real duration //!< Simulated duration (s)
+    )
+    {
+      PIDDLE_ASSERT(!this->m_running, "Piddle::ControllerExecutor::simulate(...): executor is already running.");
+      this->m_running = true;
+      this->m_stop    = false;
+      this->allocate(true);
+      this->dispatch(duration);
+      this->m_running = false;
+    }
+
+  private:
+    //! Assign a group to the rate class with its period (created if needed)
+    void
+    classify(
+      Group * group //!< Group
+    )
+    {
+      for (std::unique_ptr<RateClass> & rate : this->m_classes)
+      {
+        if (std::abs(rate->period - group->period) <= EPSILON * rate->period)
+        {
+          rate->groups.push_back(group);
+          return;
+        }
+      }
+      std::unique_ptr<RateClass> rate(new RateClass);
+      rate->period    = group->period;
+      rate->period_ns = nanoseconds(std::llround(double(group->period) * 1.0e9));
+      PIDDLE_ASSERT(rate->period_ns > 0, "Piddle::ControllerExecutor::group(...): period " << group->period << " below 1 ns.");
+      rate->groups.push_back(group);
+      this->m_pools.clear();
+      auto it = std::find_if(this->m_classes.begin(), this->m_classes.end(),
+        [&rate](std::unique_ptr<RateClass> const & other) {return other->period > rate->period;});
+      this->m_classes.insert(it, std::move(rate));
+    }
+
+    //! Create the worker thread pools, either one per rate class with its
+    //! share of the workers on disjoint cores (real time) or a single pool
+    //! shared by all rate classes (simulated time). Pools are kept across
+    //! runs until the rate classes or the layout change.
+    void
+    allocate(
+      bool shared //!< Single shared pool flag
+    )
+    {
+      if (!this->m_pools.empty() && this->m_shared == shared)
+        return;
+      this->m_pools.clear();
+      this->m_shared = shared;
+      if (shared)
+      {
+        this->m_pools.emplace_back(new ThreadPool(this->m_threads, this->m_pin));
+        for (std::unique_ptr<RateClass> & rate : this->m_classes)
+          rate->pool = this->m_pools.back().get();
+        return;
+      }
+      integer core = 0;
+      for (integer i = 0; i < this->rate_classes(); ++i)
+      {
+        integer threads = this->threads(i);
+        this->m_pools.emplace_back(new ThreadPool(threads, this->m_pin, core));
+        this->m_classes[i]->pool = this->m_pools.back().get();
+        core += threads;
+      }
+    }
+
+    //! Run a single tick of a rate class on the thread pool
+    void
+    tick(
+      RateClass & rate //!< Rate class
+    )
+    {
+      auto task = [&rate](integer index)
+      {
+        Group & group = *rate.groups[index];
+        for (Loop & loop : group.loops)
+        {
+          real output = loop.block->setup(loop.input(), group.period);
+          if (loop.output)
+            loop.output(output);
+        }
+      };
+      rate.pool->run(integer(rate.groups.size()), task);
+    }
+
+    //! Convert a run duration into nanoseconds (saturated for endless runs)
+    static nanoseconds
+    duration_ns(
+      real duration //!< Run duration (s)
+    )
+    {
+      return duration < real(9.0e9) ? nanoseconds(std::llround(double(duration) * 1.0e9))
+                                    : std::numeric_limits<nanoseconds>::max();
+    }
+
+    //! Record the timing of a rate class tick
+    static void
+    record(
+      RateClass & rate,      //!< Rate class
+      nanoseconds execution, //!< Tick execution time
+      nanoseconds lateness,  //!< Release lateness
+      bool        missed     //!< Deadline miss flag
+    )
+    {
+      rate.ticks.fetch_add(1, std::memory_order_relaxed);
+      if (missed)
+        rate.deadline_misses.fetch_add(1, std::memory_order_relaxed);
+      rate.jitter_sum.fetch_add(lateness, std::memory_order_relaxed);
+      if (lateness > rate.jitter_max.load(std::memory_order_relaxed))
+        rate.jitter_max.store(lateness, std::memory_order_relaxed);
+      if (execution > rate.execution_max.load(std::memory_order_relaxed))
+        rate.execution_max.store(execution, std::memory_order_relaxed);
+    }
+
+    //! Launch one real-time dispatcher thread per rate class, with releases
+    //! aligned on a common start time
+    void
+    launch(
+      real duration //!< Run duration (s)
+    )
+    {
+      nanoseconds       end   = duration_ns(duration);
+      clock::time_point start = clock::now();
+      for (std::unique_ptr<RateClass> & rate : this->m_classes)
+        this->m_dispatchers.emplace_back(&ControllerExecutor::release_ticks, this, rate.get(), start, end);
+    }
+
+    //! Release the ticks of a rate class in real time until the duration is
+    //! elapsed or a stop is requested (an overrunning tick delays only the
+    //! next releases of its own rate class)
+    void
+    release_ticks(
+      RateClass *       rate,  //!< Rate class
+      clock::time_point start, //!< Common start time
+      nanoseconds       end    //!< Run duration (ns)
+    )
+    {
+      for (nanoseconds release = 0; release < end && !this->m_stop.load(std::memory_order_relaxed);
+           release += rate->period_ns)
+      {
+        clock::time_point release_time = start + std::chrono::nanoseconds(release);
+        std::this_thread::sleep_until(release_time);
+
+        clock::time_point begin = clock::now();
+        this->tick(*rate);
+        clock::time_point finish = clock::now();
+
+        record(*rate, std::chrono::duration_cast<std::chrono::nanoseconds>(finish - begin).count(),
+               std::chrono::duration_cast<std::chrono::nanoseconds>(begin - release_time).count(),
+               finish > release_time + std::chrono::nanoseconds(rate->period_ns));
+      }
+    }
+
+    //! Run all the rate class releases of the simulated duration in simulated
+    //! time order (releases at the same time are run fastest first)
+    void
+    dispatch(
+      real duration //!< Simulated duration (s)
+    )
+    {
+      integer classes = this->rate_classes();
+      if (classes == 0)
+        return;
+      nanoseconds end = duration_ns(duration);
+      std::vector<nanoseconds> release(std::size_t(classes), 0);
+      while (!this->m_stop.load(std::memory_order_relaxed))
+      {
+        integer next = 0;
+        for (integer i = 1; i < classes; ++i)
+          if (release[i] < release[next])
+            next = i;
+        if (release[next] >= end)
+          break;
+
+        RateClass & rate = *this->m_classes[next];
+        clock::time_point begin = clock::now();
+        this->tick(rate);
+        clock::time_point finish = clock::now();
+
+        nanoseconds execution = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - begin).count();
+        record(rate, execution, 0, execution > rate.period_ns);
+        release[next] += rate.period_ns;
+      }
+    }
+
+  }; // class ControllerExecutor
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Executor.hh
+///
@@ -41,20 +41,211 @@ namespace Piddle
    |
   \*/
 
+  //! Class to represent a static first order Butterworth low-pass filter.
+  //! Transformation done using the matched-Z-transform method.
+  template <typename Scalar>
+  class BasicFilter
+  {
+  private:
+    Scalar m_cutoff_frequency;       //!< Cut-off frequency (Hz)
+    Scalar m_output = Scalar(0.0);   //!< Previous output value
+    Scalar m_alpha  = Scalar(0.0);   //!< Cached discretised coefficient
+    Scalar m_dt     = Scalar(0.0);   //!< Time step of the cached coefficient
+    Scalar m_fc     = Scalar(0.0);   //!< Cut-off frequency of the cached coefficient
+    bool   m_cached = false;         //!< Cached coefficient validity flag
+
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+    //! Class constructor
+    BasicFilter(
+      Scalar cutoff_frequency = Scalar(0.0) //!< Cut-off frequency (Hz)
+    )
+      : m_cutoff_frequency(cutoff_frequency)
+    {
+    }
+
+    //! Get cut-off frequency const reference
+    Scalar const &
+    cutoff_frequency(void) const
+    {
+      return this->m_cutoff_frequency;
+    }
+
+    //! Get cut-off frequency reference
+    Scalar &
+    cutoff_frequency(void)
+    {
+      return this->m_cutoff_frequency;
+    }
+
+    //! Get output value const reference
+    Scalar const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Get output value reference
+    Scalar &
+    output(void)
+    {
+      return this->m_output;
+    }
+
+    //! Get discretised coefficient for a given time step
+    Scalar
+    coefficient(
+      Scalar dt //!< Time step
+    )
+    {
+      // Coefficient is recomputed only when the time step or the cut-off
+      // frequency change
+      if (!this->m_cached || !(dt == this->m_dt) || !(this->m_cutoff_frequency == this->m_fc))
+        this->discretise(dt);
+      return this->m_alpha;
+    }
+
+    //! Setup low-pass filter component
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar dt     //!< Time dt
+    )
+    {
+      Scalar alpha = this->coefficient(dt);
+      return this->m_output += (input - this->m_output) * alpha;
+    }
+
+    //! Setup low-pass filter component over a batch of samples (fused
+    //! first order recurrence, coefficient checked once for a fixed time step)
+    void
+    process(
+      std::span<Scalar const> input, //!< Input values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    {
+      check_batch(input, dt, out, "BasicFilter::process");
+      Scalar const * source = input.data();
+      Scalar *       output = out.data();
+      Scalar         y      = this->m_output;
+      std::size_t    k      = 0;
+      while (k < input.size())
+      {
+        // Constant time step runs share the same coefficient
+        Scalar h = dt.size() == 1 ? dt[0] : dt[k];
+        if (!this->m_cached || !(h == this->m_dt) || !(this->m_cutoff_frequency == this->m_fc))
+          this->discretise(h);
+        Scalar const alpha = this->m_alpha;
+        std::size_t  end   = k + 1;
+        if (dt.size() == 1)
+          end = input.size();
+        else
+          while (end < input.size() && dt[end] == h)
+            ++end;
+        for (; k < end; ++k)
+          output[k] = y += (source[k] - y) * alpha;
+      }
+      this->m_output = y;
+    }
+
+    //! Save low-pass filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_cutoff_frequency);
+      writer.write(this->m_output);
+    }
+
+    //! Restore low-pass filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_cutoff_frequency);
+      reader.read(this->m_output);
+    }
+
+    //! Reset filter component
+    void
+    reset(void)
+    {
+      this->m_output = Scalar(0.0);
+    }
+
+  private:
+    //! Compute the discretised coefficient (evaluated in double precision for any scalar type)
+    void
+    discretise(
+      Scalar dt //!< Time step
+    )
+    {
+      this->m_alpha  = Scalar(1.0 - std::exp(-static_cast<double>(dt) * 2.0 * PI * static_cast<double>(this->m_cutoff_frequency)));
+      this->m_dt     = dt;
+      this->m_fc     = this->m_cutoff_frequency;
+      this->m_cached = true;
+    }
+
+  }; // class BasicFilter
+
+  //! Class to represent a removed static low-pass filter
+  template <typename Scalar>
+  class NoFilter
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Component presence flag
+
+    //! Setup low-pass filter component (pass-through)
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar        //!< Time dt
+    )
+    const
+    {
+      return input;
+    }
+
+    //! Setup low-pass filter component over a batch of samples (pass-through)
+    void
+    process(
+      std::span<Scalar const> input, //!< Input values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    const
+    {
+      check_batch(input, dt, out, "NoFilter::process");
+      if (input.data() != out.data())
+        std::copy(input.begin(), input.end(), out.begin());
+    }
+
+    //! Reset filter component
+    void
+    reset(void)
+    {
+    }
+
+  }; // class NoFilter
+
   //! Class to represent first order Butterworth low-pass filter.
   //! Transformation done using the matched-Z-transform method.
   class Filter : public Block
   {
   private:
-    real m_cutoff_frequency;   //!< Cut-off frequency (Hz)
-    real m_output = real(0.0); //!< Previous output value
+    BasicFilter<real> m_core; //!< Static low-pass filter component
 
   public:
     //! Class constructor
     Filter(
-      real cutoff_frequency //!< Cut-off frequency (Hz)
+      real cutoff_frequency = real(0.0) //!< Cut-off frequency (Hz)
     )
-      : m_cutoff_frequency(cutoff_frequency)
+      : m_core(cutoff_frequency)
     {
     }
 
@@ -62,28 +253,37 @@ namespace Piddle
     real const &
     cutoff_frequency(void) const
     {
-      return this->m_cutoff_frequency;
+      return this->m_core.cutoff_frequency();
     }
 
     //! Get cut-off frequency reference
     real &
     cutoff_frequency(void)
     {
-      return this->m_cutoff_frequency;
+      return this->m_core.cutoff_frequency();
     }
 
     //! Get output value const reference
     real const &
     output(void) const
     {
-      return this->m_output;
+      return this->m_core.output();
     }
 
     //! Get output value reference
     real &
     output(void)
     {
-      return this->m_output;
+      return this->m_core.output();
+    }
+
+    //! Get discretised coefficient for a given time step
+    real
+    coefficient(
+      real dt //!< Time step
+    )
+    {
+      return this->m_core.coefficient(dt);
     }
 
     //! Setup low-pass filter component
@@ -92,22 +292,68 @@ namespace Piddle
       real input, //!< Input value
       real dt     //!< Time dt
     )
-    const override
+    override
     {
       if (this->is_enabled())
-        return this->m_output += (input - this->m_output) * (1.0 - std::exp(-dt * 2.0 * iddle::PI * this->frequency));
+        return this->m_core.setup(input, dt);
       else
         return real(0.0);
     }
 
+    //! Setup low-pass filter component over a batch of samples
+    void
+    process(
+      std::span<real const> input, //!< Input values
+      std::span<real const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      if (this->is_enabled())
+        this->m_core.process(input, dt, out);
+      else
+      {
+        check_batch(input, dt, out, "Filter::process");
+        std::fill(out.begin(), out.end(), real(0.0));
+      }
+    }
+
+    //! Save low-pass filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_FILTER);
+      this->m_core.save(writer);
+    }
+
+    //! Restore low-pass filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_FILTER);
+      this->m_core.restore(reader);
+    }
+
     //! Reset filter component
-    real
-    reset(void)
-        override
+    void
+    reset(void) override
     {
-      this->m_output = real(0.0);
+      this->m_core.reset();
     };
 
+    //! Get a copy of the filter component
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<Filter>(*this);
+    }
+
   }; // class Filter
 
 } // namespace Piddle
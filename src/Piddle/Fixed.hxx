@@ -0,0 +1,236 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Fixed.hh
+///
+
+#ifndef INCLUDE_PIDDLE_FIXED
+#define INCLUDE_PIDDLE_FIXED
+
+#include <cstdint>
+#include <limits>
+
+namespace Piddle
+{
+
+  /*\
+   |   _____ _               _
+   |  |  ___(_)_  __ ___  __| |
+   |  | |_  | \ \/ // _ \/ _` |
+   |  |  _| | |>  <|  __/ (_| |
+   |  |_|   |_/_/\_\\___|\__,_|
+   |
+  \*/
+
+  //! Class to represent a signed fixed-point number with FRACTION fractional
+  //! bits, stored in a Storage integer and computed through a Wide integer.
+  //! Arithmetic saturates to the Storage range instead of overflowing, and a
+  //! division by zero saturates to the bound with the dividend sign (zero if
+  //! the dividend is zero). It can be used as scalar type of the static
+  //! controllers.
+  template <
+    integer  FRACTION = 16,
+    typename Storage  = std::int32_t,
+    typename Wide     = std::int64_t
+  >
+  class Fixed
+  {
+    static_assert(sizeof(Wide) >= 2 * sizeof(Storage), "Fixed wide type must double the storage width");
+    static_assert(FRACTION > 0 && FRACTION < integer(8 * sizeof(Storage) - 1), "Fixed fractional bits out of range");
+
+  private:
+    Storage m_raw = Storage(0); //!< Raw fixed-point value
+
+    static constexpr Wide    ONE     = Wide(1) << FRACTION;                    //!< Raw unit value
+    static constexpr Storage RAW_MAX = std::numeric_limits<Storage>::max();    //!< Largest raw value
+    static constexpr Storage RAW_MIN = std::numeric_limits<Storage>::lowest(); //!< Smallest raw value
+
+    //! Saturate a wide raw value to the storage range
+    static constexpr Storage
+    saturate(
+      Wide raw //!< Wide raw value
+    )
+    {
+      return raw > Wide(RAW_MAX) ? RAW_MAX : (raw < Wide(RAW_MIN) ? RAW_MIN : Storage(raw));
+    }
+
+    //! Saturate a floating-point value to the storage range (rounded to
+    //! nearest, not-a-number values are mapped to zero)
+    static constexpr Storage
+    saturate(
+      double value //!< Floating-point value
+    )
+    {
+      double raw = value * double(ONE) + (value < 0.0 ? -0.5 : 0.5);
+      if (raw >= double(RAW_MAX))
+        return RAW_MAX;
+      if (raw <= double(RAW_MIN))
+        return RAW_MIN;
+      return raw == raw ? Storage(raw) : Storage(0);
+    }
+
+  public:
+    //! Class constructor
+    constexpr
+    Fixed(void)
+    {
+    }
+
+    //! Class constructor from a floating-point value (rounded to nearest and
+    //! saturated to the representable range)
+    constexpr explicit
+    Fixed(
+      double value //!< Floating-point value
+    )
+      : m_raw(saturate(value))
+    {
+    }
+
+    //! Build a fixed-point number from its raw representation
+    static constexpr Fixed
+    from_raw(
+      Storage raw //!< Raw fixed-point value
+    )
+    {
+      Fixed out;
+      out.m_raw = raw;
+      return out;
+    }
+
+    //! Get raw fixed-point value
+    constexpr Storage
+    raw(void) const
+    {
+      return this->m_raw;
+    }
+
+    //! Convert to floating-point value
+    constexpr explicit
+    operator double(void) const
+    {
+      return double(this->m_raw) / double(ONE);
+    }
+
+    //! Unary minus operator
+    constexpr Fixed
+    operator-(void) const
+    {
+      return from_raw(saturate(-Wide(this->m_raw)));
+    }
+
+    //! Sum operator
+    friend constexpr Fixed
+    operator+(Fixed a, Fixed b)
+    {
+      return from_raw(saturate(Wide(a.m_raw) + Wide(b.m_raw)));
+    }
+
+    //! Difference operator
+    friend constexpr Fixed
+    operator-(Fixed a, Fixed b)
+    {
+      return from_raw(saturate(Wide(a.m_raw) - Wide(b.m_raw)));
+    }
+
+    //! Product operator
+    friend constexpr Fixed
+    operator*(Fixed a, Fixed b)
+    {
+      return from_raw(saturate((Wide(a.m_raw) * Wide(b.m_raw)) >> FRACTION));
+    }
+
+    //! Quotient operator
+    friend constexpr Fixed
+    operator/(Fixed a, Fixed b)
+    {
+      if (b.m_raw == Storage(0))
+        return from_raw(a.m_raw > Storage(0) ? RAW_MAX : (a.m_raw < Storage(0) ? RAW_MIN : Storage(0)));
+      return from_raw(saturate((Wide(a.m_raw) * ONE) / Wide(b.m_raw)));
+    }
+
+    //! Sum assignment operator
+    constexpr Fixed &
+    operator+=(Fixed b)
+    {
+      return *this = *this + b;
+    }
+
+    //! Difference assignment operator
+    constexpr Fixed &
+    operator-=(Fixed b)
+    {
+      return *this = *this - b;
+    }
+
+    //! Product assignment operator
+    constexpr Fixed &
+    operator*=(Fixed b)
+    {
+      return *this = *this * b;
+    }
+
+    //! Quotient assignment operator
+    constexpr Fixed &
+    operator/=(Fixed b)
+    {
+      return *this = *this / b;
+    }
+
+    //! Comparison operators
+    friend constexpr bool operator==(Fixed a, Fixed b) {return a.m_raw == b.m_raw;}
+    friend constexpr bool operator!=(Fixed a, Fixed b) {return a.m_raw != b.m_raw;}
+    friend constexpr bool operator<(Fixed a, Fixed b) {return a.m_raw < b.m_raw;}
+    friend constexpr bool operator>(Fixed a, Fixed b) {return a.m_raw > b.m_raw;}
+    friend constexpr bool operator<=(Fixed a, Fixed b) {return a.m_raw <= b.m_raw;}
+    friend constexpr bool operator>=(Fixed a, Fixed b) {return a.m_raw >= b.m_raw;}
+
+  }; // class Fixed
+
+} // namespace Piddle
+
+//! Numeric limits of the fixed-point number type
+template <Piddle::integer FRACTION, typename Storage, typename Wide>
+struct std::numeric_limits<Piddle::Fixed<FRACTION, Storage, Wide>>
+{
+private:
+  typedef Piddle::Fixed<FRACTION, Storage, Wide> type;
+
+public:
+  static constexpr bool is_specialized = true;
+  static constexpr bool is_signed      = true;
+  static constexpr bool is_integer     = false;
+  static constexpr bool is_exact       = true;
+  static constexpr bool has_infinity   = false;
+  static constexpr bool has_quiet_NaN  = false;
+
+  static constexpr type min(void) {return type::from_raw(Storage(1));}
+  static constexpr type max(void) {return type::from_raw(std::numeric_limits<Storage>::max());}
+  static constexpr type lowest(void) {return type::from_raw(std::numeric_limits<Storage>::lowest());}
+  static constexpr type epsilon(void) {return type::from_raw(Storage(1));}
+};
+
+#endif
+
+///
+/// eof: Fixed.hh
+///
@@ -0,0 +1,860 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Graph.hh
+///
+
+#ifndef INCLUDE_PIDDLE_GRAPH
+#define INCLUDE_PIDDLE_GRAPH
+
+#include "Pid.hxx"
+#include "PidBank.hxx"
+
+#include <cstdint>
+#include <initializer_list>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace Piddle
+{
+
+  /*\
+   |    ____                 _
+   |   / ___|_ __ __ _ _ __ | |__
+   |  | |  _| '__/ _` | '_ \| '_ \
+   |  | |_| | | | (_| | |_) | | | |
+   |   \____|_|  \__,_| .__/|_| |_|
+   |                  |_|
+  \*/
+
+  //! Class to represent a graph of controller blocks (pid loops, low-pass
+  //! filters, saturations, feedforward gains and weighted sums) wired together,
+  //! e.g. position, velocity and current cascades or coupled MIMO loops. Nodes
+  //! read already existing nodes only, so that the graph is acyclic by
+  //! construction. Compiling the graph sorts the nodes by depth into a flat
+  //! schedule of stages, where each stage is a run of nodes of the same kind
+  //! stored as a structure-of-arrays, so that a step is a sequence of tight
+  //! loops without any virtual dispatch (pid loop stages are ranges of lanes
+  //! stepped by the PIDBank kernels). Every node reproduces its source block
+  //! step bit for bit (provided that floating-point contraction is disabled, as
+  //! for PIDBank), except that pid loops with cascade tracking also freeze
+  //! their integrators while any pid loop or saturation downstream of them was
+  //! saturated at the previous step (conditional integration propagated up the
+  //! cascade).
+  class ControllerGraph
+  {
+  public:
+    typedef integer node; //!< Node handle type
+
+    //! Enumeration of the node kinds
+    enum Kind : integer
+    {
+      NODE_INPUT       = 0, //!< External input (setpoint, measurement, feedforward signal)
+      NODE_SUM         = 1, //!< Weighted sum of nodes
+      NODE_FEEDFORWARD = 2, //!< Static and derivative feedforward gain
+      NODE_FILTER      = 3, //!< First order low-pass filter
+      NODE_SATURATION  = 4, //!< Saturation
+      NODE_PID         = 5, //!< Pid loop
+      NODE_KINDS       = 6  //!< Number of node kinds
+    };
+
+  private:
+    typedef std::uint8_t  flag; //!< Per-node boolean type
+    typedef PIDBank::mask mask; //!< Per-node mask type (all bits set if true)
+
+    //! Node of the graph
+    struct Node
+    {
+      Kind    kind;         //!< Node kind
+      integer slot;         //!< Index in the arrays of the node kind (execution order once compiled)
+      integer first;        //!< First source index
+      integer count;        //!< Number of sources
+      integer level    = 0; //!< Depth in the graph (inputs have null depth)
+      integer position = 0; //!< Index in the schedule
+    };
+
+    //! Run of nodes of the same kind and depth
+    struct Stage
+    {
+      Kind    kind;     //!< Node kind
+      integer position; //!< First node index in the schedule
+      integer slot;     //!< First node index in the arrays of the node kind
+      integer count;    //!< Number of nodes
+      bool    tracking; //!< Cascade tracking flag (pid loop stages with tracking nodes)
+    };
+
+    //! Weighted sum nodes (compiled sources in execution order)
+    struct SumNodes
+    {
+      std::vector<integer> offset; //!< First term index of each node (plus the end)
+      std::vector<integer> source; //!< Term sources
+      std::vector<real>    weight; //!< Term weights
+    };
+
+    //! Feedforward nodes
+    struct FeedforwardNodes
+    {
+      std::vector<real> gain;       //!< Static gains
+      std::vector<real> derivative; //!< Derivative gains
+      std::vector<real> input;      //!< Previous input values
+
+      //! Apply a function to every array
+      template <typename Self, typename Function>
+      static void
+      arrays(Self & self, Function && function)
+      {
+        function(self.gain);
+        function(self.derivative);
+        function(self.input);
+      }
+    };
+
+    //! Low-pass filter nodes
+    struct FilterNodes
+    {
+      std::vector<real> fc;      //!< Cut-off frequencies
+      std::vector<real> output;  //!< Previous output values
+      std::vector<real> alpha;   //!< Filter coefficients
+      std::vector<flag> enabled; //!< Enabling states
+
+      //! Apply a function to every array
+      template <typename Self, typename Function>
+      static void
+      arrays(Self & self, Function && function)
+      {
+        function(self.fc);
+        function(self.output);
+        function(self.alpha);
+        function(self.enabled);
+      }
+    };
+
+    //! Saturation nodes
+    struct SaturationNodes
+    {
+      std::vector<real> upper;   //!< Upper bounds
+      std::vector<real> lower;   //!< Lower bounds
+      std::vector<flag> enabled; //!< Enabling states
+
+      //! Apply a function to every array
+      template <typename Self, typename Function>
+      static void
+      arrays(Self & self, Function && function)
+      {
+        function(self.upper);
+        function(self.lower);
+        function(self.enabled);
+      }
+    };
+
+    // Graph
+    std::vector<Node>    m_nodes;      //!< Nodes in creation order
+    std::vector<node>    m_sources;    //!< Node sources
+    std::vector<real>    m_weights;    //!< Node source weights (sum nodes only)
+    std::vector<node>    m_outputs;    //!< Output nodes
+    integer              m_inputs = 0; //!< Number of input nodes
+    integer              m_sums   = 0; //!< Number of sum nodes
+
+    // Compiled schedule
+    bool                 m_compiled = false;     //!< Compiled schedule validity flag
+    std::vector<Stage>   m_stages;               //!< Stages in execution order (inputs excluded)
+    std::vector<integer> m_source;               //!< Source schedule index of each single source node
+    std::vector<integer> m_output_positions;     //!< Schedule indices of the output nodes
+    std::vector<real>    m_value;                //!< Node output values in schedule order
+    std::vector<mask>    m_clamped;              //!< Node saturation masks of the last step in schedule order
+    real                 m_alpha_dt = QUIET_NAN; //!< Time step of the cached filter coefficients
+
+    // Node arrays
+    SumNodes             m_sum;         //!< Sum nodes
+    FeedforwardNodes     m_feedforward; //!< Feedforward nodes
+    FilterNodes          m_filter;      //!< Low-pass filter nodes
+    SaturationNodes      m_saturation;  //!< Saturation nodes
+
+    // Pid loop nodes
+    PIDBank                    m_bank;         //!< Pid loop lanes in execution order
+    std::vector<flag>          m_tracking;     //!< Cascade tracking flags
+    std::vector<integer>       m_track_offset; //!< First tracked node index of each loop (plus the end)
+    std::vector<integer>       m_track;        //!< Schedule indices of the tracked downstream nodes
+    std::vector<mask>          m_hold;         //!< Integrator hold masks
+
+  public:
+    //! Class constructor
+    ControllerGraph(void)
+    {
+    }
+
+    //! Get the number of nodes
+    integer
+    size(void) const
+    {
+      return integer(this->m_nodes.size());
+    }
+
+    //! Get the number of input nodes
+    integer
+    inputs(void) const
+    {
+      return this->m_inputs;
+    }
+
+    //! Get the number of output nodes
+    integer
+    outputs(void) const
+    {
+      return integer(this->m_outputs.size());
+    }
+
+    //! Get the number of stages of the compiled schedule
+    integer
+    stages(void) const
+    {
+      return integer(this->m_stages.size());
+    }
+
+    //! Check if the schedule is compiled
+    bool
+    is_compiled(void) const
+    {
+      return this->m_compiled;
+    }
+
+    //! Get node kind
+    Kind
+    kind(
+      node n //!< Node handle
+    )
+    const
+    {
+      this->check(n, "kind");
+      return this->m_nodes[n].kind;
+    }
+
+    //! Add an external input node, input values are given to the setup call
+    //! in the input nodes creation order
+    node
+    input(void)
+    {
+      return this->add(NODE_INPUT, this->m_inputs++, {}, {});
+    }
+
+    //! Add a weighted sum node (unit weights if none are given)
+    node
+    sum(
+      std::span<node const> sources,     //!< Source nodes
+      std::span<real const> weights = {} //!< Source weights
+    )
+    {
+      PIDDLE_ASSERT(!sources.empty(), "Piddle::ControllerGraph::sum(...): no sources.");
+      PIDDLE_ASSERT(weights.empty() || weights.size() == sources.size(),
+        "Piddle::ControllerGraph::sum(...): weights size " << weights.size() << " does not match sources size " << sources.size() << ".");
+      return this->add(NODE_SUM, this->m_sums++, sources, weights);
+    }
+
+    //! Add a weighted sum node (unit weights if none are given)
+    node
+    sum(
+      std::initializer_list<node> sources,     //!< Source nodes
+      std::initializer_list<real> weights = {} //!< Source weights
+    )
+    {
+      return this->sum(std::span<node const>(sources.begin(), sources.size()),
+                       std::span<real const>(weights.begin(), weights.size()));
+    }
+
+    //! Add a difference node (e.g. the error between a setpoint and a measurement)
+    node
+    difference(
+      node minuend,   //!< Minuend node
+      node subtrahend //!< Subtrahend node
+    )
+    {
+      return this->sum({minuend, subtrahend}, {real(1.0), real(-1.0)});
+    }
+
+    //! Add a feedforward node, whose output is the source value scaled by the
+    //! static gain plus the source time derivative scaled by the derivative gain
+    node
+    feedforward(
+      node source,                        //!< Source node
+      real gain,                          //!< Static gain
+      real derivative_gain = real(0.0)    //!< Derivative gain
+    )
+    {
+      integer slot = integer(this->m_feedforward.gain.size());
+      node    n    = this->add(NODE_FEEDFORWARD, slot, std::span<node const>(&source, 1), {});
+      FeedforwardNodes::arrays(this->m_feedforward, [](auto & v) {v.emplace_back();});
+      this->m_feedforward.gain[slot]       = gain;
+      this->m_feedforward.derivative[slot] = derivative_gain;
+      return n;
+    }
+
+    //! Add a low-pass filter node initialized from a filter block
+    node
+    filter(
+      Filter const & block, //!< Low-pass filter block
+      node           source //!< Source node
+    )
+    {
+      integer slot = integer(this->m_filter.fc.size());
+      node    n    = this->add(NODE_FILTER, slot, std::span<node const>(&source, 1), {});
+      FilterNodes::arrays(this->m_filter, [](auto & v) {v.emplace_back();});
+      this->m_filter.fc[slot]      = block.cutoff_frequency();
+      this->m_filter.enabled[slot] = block.is_enabled();
+      return n;
+    }
+
+    //! Add a saturation node initialized from an anti-windup block
+    node
+    saturation(
+      Antiwindup const & block, //!< Anti-windup block
+      node               source //!< Source node
+    )
+    {
+      integer slot = integer(this->m_saturation.upper.size());
+      node    n    = this->add(NODE_SATURATION, slot, std::span<node const>(&source, 1), {});
+      SaturationNodes::arrays(this->m_saturation, [](auto & v) {v.emplace_back();});
+      this->m_saturation.upper[slot]   = block.upper();
+      this->m_saturation.lower[slot]   = block.lower();
+      this->m_saturation.enabled[slot] = block.is_enabled();
+      return n;
+    }
+
+    //! Add a pid loop node initialized from a pid block (custom derivative
+    //! filters and parameter channels are not carried over). With cascade
+    //! tracking, the integrator is also frozen while any pid loop or
+    //! saturation downstream of the node was saturated at the previous step.
+    node
+    pid(
+      PID const & block,          //!< Pid block
+      node        error,          //!< Error node
+      bool        tracking = true //!< Cascade tracking flag
+    )
+    {
+      PIDDLE_ASSERT(!block.derivative().custom_filter(),
+        "Piddle::ControllerGraph::pid(...): custom derivative filters are not supported by the graph nodes.");
+      node n = this->add(NODE_PID, this->m_bank.size(), std::span<node const>(&error, 1), {});
+      this->m_bank.push_back(block);
+      this->m_tracking.push_back(tracking);
+      return n;
+    }
+
+    //! Mark a node as an output and get its output index, output values are
+    //! returned by the setup call in the output marking order
+    integer
+    output(
+      node n //!< Node handle
+    )
+    {
+      this->check(n, "output");
+      this->m_outputs.push_back(n);
+      this->m_compiled = false;
+      return integer(this->m_outputs.size()) - 1;
+    }
+
+    //! Get pid loop node parameter set
+    PIDParameters
+    parameters(
+      node n //!< Pid loop node handle
+    )
+    const
+    {
+      return this->m_bank.parameters(this->slot(n, NODE_PID, "parameters"));
+    }
+
+    //! Set pid loop node parameter set, with bumpless transfer as in the pid
+    //! block (integral value rescaled across an integral gain change)
+    void
+    parameters(
+      node                  n,               //!< Pid loop node handle
+      PIDParameters const & parameters,      //!< Parameter set
+      bool                  bumpless = false //!< Bumpless transfer flag
+    )
+    {
+      this->m_bank.parameters(this->slot(n, NODE_PID, "parameters"), parameters, bumpless);
+    }
+
+    //! Get node output value of the last step
+    real
+    value(
+      node n //!< Node handle
+    )
+    const
+    {
+      this->check(n, "value");
+      PIDDLE_ASSERT(this->m_compiled, "Piddle::ControllerGraph::value(...): graph is not compiled.");
+      return this->m_value[this->m_nodes[n].position];
+    }
+
+    //! Check if a pid loop or saturation node was saturated at the last step
+    bool
+    is_saturated(
+      node n //!< Node handle
+    )
+    const
+    {
+      this->check(n, "is_saturated");
+      PIDDLE_ASSERT(this->m_compiled, "Piddle::ControllerGraph::is_saturated(...): graph is not compiled.");
+      return this->m_clamped[this->m_nodes[n].position] != 0;
+    }
+
+    //! Compile the graph into a flat schedule and reset all the node states.
+    //! Nodes are sorted by depth and kind, each run of nodes of the same depth
+    //! and kind becomes a stage, and the node arrays are permuted into
+    //! execution order. Tracked downstream nodes of every pid loop are
+    //! collected through all the paths leaving it.
+    void
+    compile(void)
+    {
+      integer n = this->size();
+
+      // Node depths (sources always precede their consumers)
+      for (Node & v : this->m_nodes)
+      {
+        v.level = 0;
+        for (integer j = v.first; j < v.first + v.count; ++j)
+          v.level = std::max(v.level, this->m_nodes[this->m_sources[j]].level + 1);
+      }
+
+      // Execution order (inputs come first in creation order)
+      std::vector<node> order(n);
+      std::iota(order.begin(), order.end(), node(0));
+      std::stable_sort(order.begin(), order.end(), [this](node a, node b) {
+        Node const & u = this->m_nodes[a];
+        Node const & v = this->m_nodes[b];
+        return u.level < v.level || (u.level == v.level && u.kind < v.kind);
+      });
+
+      // Stages and node positions, arrays slots are renumbered in execution order
+      std::vector<integer> slots[NODE_KINDS];
+      this->m_stages.clear();
+      for (integer p = 0; p < n; ++p)
+      {
+        Node & v = this->m_nodes[order[p]];
+        v.position = p;
+        if (v.kind != NODE_INPUT)
+        {
+          integer slot = integer(slots[v.kind].size());
+          if (this->m_stages.empty() || this->m_stages.back().kind != v.kind ||
+              this->m_nodes[order[p - 1]].level != v.level)
+            this->m_stages.push_back(Stage{v.kind, p, slot, 0, false});
+          ++this->m_stages.back().count;
+        }
+        slots[v.kind].push_back(v.slot);
+        v.slot = integer(slots[v.kind].size()) - 1;
+      }
+      auto permute = [](std::vector<integer> const & old_slots) {
+        return [&old_slots](auto & v) {
+          auto old = v;
+          for (std::size_t j = 0; j < old_slots.size(); ++j)
+            v[j] = old[old_slots[j]];
+        };
+      };
+      FeedforwardNodes::arrays(this->m_feedforward, permute(slots[NODE_FEEDFORWARD]));
+      FilterNodes::arrays(this->m_filter, permute(slots[NODE_FILTER]));
+      SaturationNodes::arrays(this->m_saturation, permute(slots[NODE_SATURATION]));
+      permute(slots[NODE_PID])(this->m_tracking);
+      PIDBank bank(integer(slots[NODE_PID].size()));
+      for (integer j = 0; j < bank.size(); ++j)
+        bank.assign(j, this->m_bank.lane(slots[NODE_PID][j]));
+      this->m_bank = std::move(bank);
+      this->m_hold.resize(slots[NODE_PID].size());
+      this->track_stages();
+
+      // Node consumers
+      std::vector<integer> consumer_offset(n + 1, 0);
+      std::vector<node>    consumers(this->m_sources.size());
+      for (node source : this->m_sources)
+        ++consumer_offset[source + 1];
+      std::partial_sum(consumer_offset.begin(), consumer_offset.end(), consumer_offset.begin());
+      std::vector<integer> fill(consumer_offset.begin(), consumer_offset.end() - 1);
+      for (node v = 0; v < n; ++v)
+        for (integer j = this->m_nodes[v].first; j < this->m_nodes[v].first + this->m_nodes[v].count; ++j)
+          consumers[fill[this->m_sources[j]]++] = v;
+
+      // Sources, sum terms and tracked downstream nodes in execution order
+      this->m_source.assign(n, integer(-1));
+      this->m_sum.offset.assign(1, integer(0));
+      this->m_sum.source.clear();
+      this->m_sum.weight.clear();
+      this->m_track_offset.assign(1, integer(0));
+      this->m_track.clear();
+      std::vector<node> visited(n, node(-1));
+      std::vector<node> pending;
+      for (integer p = 0; p < n; ++p)
+      {
+        node         u = order[p];
+        Node const & v = this->m_nodes[u];
+        if (v.kind == NODE_SUM)
+        {
+          for (integer j = v.first; j < v.first + v.count; ++j)
+          {
+            this->m_sum.source.push_back(this->m_nodes[this->m_sources[j]].position);
+            this->m_sum.weight.push_back(this->m_weights[j]);
+          }
+          this->m_sum.offset.push_back(integer(this->m_sum.source.size()));
+        }
+        else if (v.kind != NODE_INPUT)
+        {
+          this->m_source[p] = this->m_nodes[this->m_sources[v.first]].position;
+        }
+        if (v.kind == NODE_PID)
+        {
+          std::size_t first = this->m_track.size();
+          pending.assign(1, u);
+          while (!pending.empty())
+          {
+            node w = pending.back();
+            pending.pop_back();
+            for (integer j = consumer_offset[w]; j < consumer_offset[w + 1]; ++j)
+            {
+              node c = consumers[j];
+              if (visited[c] == u)
+                continue;
+              visited[c] = u;
+              pending.push_back(c);
+              Kind k = this->m_nodes[c].kind;
+              if (k == NODE_PID || k == NODE_SATURATION)
+                this->m_track.push_back(this->m_nodes[c].position);
+            }
+          }
+          std::sort(this->m_track.begin() + first, this->m_track.end());
+          this->m_track_offset.push_back(integer(this->m_track.size()));
+        }
+      }
+
+      // Outputs and states
+      this->m_output_positions.resize(this->m_outputs.size());
+      for (std::size_t j = 0; j < this->m_outputs.size(); ++j)
+        this->m_output_positions[j] = this->m_nodes[this->m_outputs[j]].position;
+      this->m_value.assign(n, real(0.0));
+      this->m_clamped.assign(n, mask(0));
+      this->m_alpha_dt = QUIET_NAN;
+      this->m_compiled = true;
+      this->reset();
+    }
+
+    //! Reset all the node internal states
+    void
+    reset(void)
+    {
+      this->m_bank.reset();
+      for (std::vector<real> * v : {&this->m_filter.output, &this->m_feedforward.input, &this->m_value})
+        std::fill(v->begin(), v->end(), real(0.0));
+      std::fill(this->m_clamped.begin(), this->m_clamped.end(), mask(0));
+    }
+
+    //! Setup all the nodes in schedule order and gather the output values
+    void
+    setup(
+      std::span<real const> inputs, //!< Input values (one per input node)
+      real                  dt,     //!< Time step
+      std::span<real>       outputs //!< Output values (one per output node)
+    )
+    {
+      PIDDLE_ASSERT(this->m_compiled, "Piddle::ControllerGraph::setup(...): graph is not compiled.");
+      PIDDLE_ASSERT(inputs.size() == std::size_t(this->m_inputs),
+        "Piddle::ControllerGraph::setup(...): inputs size " << inputs.size() << " does not match " << this->m_inputs << " input nodes.");
+      PIDDLE_ASSERT(outputs.size() == this->m_outputs.size(),
+        "Piddle::ControllerGraph::setup(...): outputs size " << outputs.size() << " does not match " << this->m_outputs.size() << " output nodes.");
+
+      // Filter coefficients are recomputed only when the time step changes
+      if (!(dt == this->m_alpha_dt))
+      {
+        for (std::size_t s = 0; s < this->m_filter.fc.size(); ++s)
+          this->m_filter.alpha[s] = 1.0 - std::exp(-dt * 2.0 * PI * this->m_filter.fc[s]);
+        this->m_alpha_dt = dt;
+      }
+      this->m_bank.prepare(dt);
+
+      std::copy(inputs.begin(), inputs.end(), this->m_value.begin());
+      for (Stage const & stage : this->m_stages)
+      {
+        switch (stage.kind)
+        {
+        case NODE_SUM:         this->setup_sum(stage); break;
+        case NODE_FEEDFORWARD: this->setup_feedforward(stage, dt); break;
+        case NODE_FILTER:      this->setup_filter(stage); break;
+        case NODE_SATURATION:  this->setup_saturation(stage); break;
+        case NODE_PID:         this->setup_pid(stage, dt); break;
+        default: break;
+        }
+      }
+      for (std::size_t j = 0; j < outputs.size(); ++j)
+        outputs[j] = this->m_value[this->m_output_positions[j]];
+    }
+
+    //! Save all the node parameters, enabling states and internal states
+    //! (arrays are written in bulk in execution order)
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      PIDDLE_ASSERT(this->m_compiled, "Piddle::ControllerGraph::save(...): graph is not compiled.");
+      writer.write(std::uint8_t(STATE_GRAPH));
+      for (integer count : this->counts())
+        writer.write(count);
+      auto write = [&writer](auto const & v) {writer.write(std::span(v.data(), v.size()));};
+      write(this->m_value);
+      write(this->m_clamped);
+      FeedforwardNodes::arrays(this->m_feedforward, write);
+      FilterNodes::arrays(this->m_filter, write);
+      SaturationNodes::arrays(this->m_saturation, write);
+      write(this->m_tracking);
+      this->m_bank.save(writer);
+    }
+
+    //! Restore all the node parameters, enabling states and internal states
+    //! (the graph must be compiled with the same structure)
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      PIDDLE_ASSERT(this->m_compiled, "Piddle::ControllerGraph::restore(...): graph is not compiled.");
+      reader.expect(STATE_GRAPH);
+      for (integer count : this->counts())
+      {
+        integer found = reader.read<integer>();
+        PIDDLE_ASSERT(found == count,
+          "Piddle::ControllerGraph::restore(...): found " << found << " nodes instead of " << count << ".");
+      }
+      auto read = [&reader](auto & v) {reader.read(std::span(v.data(), v.size()));};
+      read(this->m_value);
+      read(this->m_clamped);
+      FeedforwardNodes::arrays(this->m_feedforward, read);
+      FilterNodes::arrays(this->m_filter, read);
+      SaturationNodes::arrays(this->m_saturation, read);
+      read(this->m_tracking);
+      this->track_stages();
+      this->m_bank.restore(reader);
+      this->m_alpha_dt = QUIET_NAN;
+    }
+
+  private:
+    //! Check node handle
+    void
+    check(
+      node         n,    //!< Node handle
+      char const * where //!< Calling method name
+    ) const
+    {
+      PIDDLE_ASSERT(n >= 0 && n < this->size(),
+        "Piddle::ControllerGraph::" << where << "(...): node " << n << " out of range [0," << this->size() << ").");
+    }
+
+    //! Check node handle and kind, and get the node index in the arrays of its kind
+    integer
+    slot(
+      node         n,    //!< Node handle
+      Kind         kind, //!< Expected node kind
+      char const * where //!< Calling method name
+    ) const
+    {
+      this->check(n, where);
+      PIDDLE_ASSERT(this->m_nodes[n].kind == kind,
+        "Piddle::ControllerGraph::" << where << "(...): node " << n << " is of kind " << this->m_nodes[n].kind
+        << " instead of " << kind << ".");
+      return this->m_nodes[n].slot;
+    }
+
+    //! Get the number of nodes of every kind (total first)
+    std::vector<integer>
+    counts(void) const
+    {
+      return {this->size(), this->m_inputs, this->m_sums, integer(this->m_feedforward.gain.size()),
+              integer(this->m_filter.fc.size()), integer(this->m_saturation.upper.size()), this->m_bank.size()};
+    }
+
+    //! Add a node, the schedule has to be compiled again
+    node
+    add(
+      Kind                  kind,    //!< Node kind
+      integer               slot,    //!< Index in the arrays of the node kind
+      std::span<node const> sources, //!< Source nodes
+      std::span<real const> weights  //!< Source weights (unit weights if empty)
+    )
+    {
+      for (node source : sources)
+        PIDDLE_ASSERT(source >= 0 && source < this->size(),
+          "Piddle::ControllerGraph::add(...): source node " << source << " out of range [0," << this->size() << ").");
+      this->m_nodes.push_back(Node{kind, slot, integer(this->m_sources.size()), integer(sources.size())});
+      for (std::size_t j = 0; j < sources.size(); ++j)
+      {
+        this->m_sources.push_back(sources[j]);
+        this->m_weights.push_back(weights.empty() ? real(1.0) : weights[j]);
+      }
+      this->m_compiled = false;
+      return this->size() - 1;
+    }
+
+    //! Flag the pid loop stages with cascade tracking nodes, the integrator
+    //! hold masks are gathered only for them
+    void
+    track_stages(void)
+    {
+      for (Stage & stage : this->m_stages)
+      {
+        stage.tracking = false;
+        if (stage.kind == NODE_PID)
+        {
+          flag const * tracks = this->m_tracking.data() + stage.slot;
+          stage.tracking = std::any_of(tracks, tracks + stage.count, [](flag f) {return f != 0;});
+        }
+      }
+    }
+
+    //! Weighted sum stage kernel
+    void
+    setup_sum(
+      Stage const & stage //!< Stage
+    )
+    {
+      real *          value  = this->m_value.data();
+      integer const * offset = this->m_sum.offset.data() + stage.slot;
+      integer const * source = this->m_sum.source.data();
+      real const *    weight = this->m_sum.weight.data();
+      for (integer k = 0; k < stage.count; ++k)
+      {
+        integer first = offset[k];
+        real    sum   = weight[first] * value[source[first]];
+        for (integer j = first + 1; j < offset[k + 1]; ++j)
+          sum += weight[j] * value[source[j]];
+        value[stage.position + k] = sum;
+      }
+    }
+
+    //! Feedforward stage kernel
+    void
+    setup_feedforward(
+      Stage const & stage, //!< Stage
+      real          dt     //!< Time step
+    )
+    {
+      real *          value      = this->m_value.data() + stage.position;
+      integer const * source     = this->m_source.data() + stage.position;
+      real const *    gain       = this->m_feedforward.gain.data() + stage.slot;
+      real const *    derivative = this->m_feedforward.derivative.data() + stage.slot;
+      real *          input      = this->m_feedforward.input.data() + stage.slot;
+      for (integer k = 0; k < stage.count; ++k)
+      {
+        real x = this->m_value[source[k]];
+        real y = gain[k] * x;
+        if (derivative[k] != real(0.0))
+          y += derivative[k] * ((x - input[k]) / dt);
+        input[k] = x;
+        value[k] = y;
+      }
+    }
+
+    //! Low-pass filter stage kernel
+    void
+    setup_filter(
+      Stage const & stage //!< Stage
+    )
+    {
+      real *          value   = this->m_value.data() + stage.position;
+      integer const * source  = this->m_source.data() + stage.position;
+      real *          output  = this->m_filter.output.data() + stage.slot;
+      real const *    alpha   = this->m_filter.alpha.data() + stage.slot;
+      flag const *    enabled = this->m_filter.enabled.data() + stage.slot;
+      for (integer k = 0; k < stage.count; ++k)
+      {
+        if (enabled[k])
+          value[k] = output[k] += (this->m_value[source[k]] - output[k]) * alpha[k];
+        else
+          value[k] = real(0.0);
+      }
+    }
+
+    //! Saturation stage kernel
+    void
+    setup_saturation(
+      Stage const & stage //!< Stage
+    )
+    {
+      real *          value   = this->m_value.data() + stage.position;
+      mask *          clamped = this->m_clamped.data() + stage.position;
+      integer const * source  = this->m_source.data() + stage.position;
+      real const *    upper   = this->m_saturation.upper.data() + stage.slot;
+      real const *    lower   = this->m_saturation.lower.data() + stage.slot;
+      flag const *    enabled = this->m_saturation.enabled.data() + stage.slot;
+      for (integer k = 0; k < stage.count; ++k)
+      {
+        real x = this->m_value[source[k]];
+        clamped[k] = (enabled[k] & ((x > upper[k]) | (x < lower[k]))) ? ~mask(0) : mask(0);
+        if (enabled[k])
+        {
+          x = x < lower[k] ? lower[k] : x;
+          x = upper[k] < x ? upper[k] : x;
+        }
+        value[k] = x;
+      }
+    }
+
+    //! Pid loop stage kernel, the stage lanes are stepped at once by the pid
+    //! bank kernels, which gather their errors from the node values, after
+    //! gathering the integrator hold masks of the tracking lanes
+    void
+    setup_pid(
+      Stage const & stage, //!< Stage
+      real          dt     //!< Time step
+    )
+    {
+      std::size_t           n = std::size_t(stage.count);
+      std::span<mask const> held;
+      if (stage.tracking)
+      {
+        mask const *    clamped = this->m_clamped.data();
+        integer const * offset  = this->m_track_offset.data() + stage.slot;
+        integer const * track   = this->m_track.data();
+        flag const *    tracks  = this->m_tracking.data() + stage.slot;
+        mask *          hold    = this->m_hold.data() + stage.slot;
+        for (integer k = 0; k < stage.count; ++k)
+        {
+          // Saturation masks of the tracked downstream nodes (previous step)
+          mask windup = mask(0);
+          if (tracks[k])
+            for (integer j = offset[k]; j < offset[k + 1]; ++j)
+              windup |= clamped[track[j]];
+          hold[k] = windup;
+        }
+        held = std::span<mask const>(hold, n);
+      }
+      this->m_bank.setup(stage.slot, std::span<real const>(this->m_value),
+                         std::span<integer const>(this->m_source.data() + stage.position, n), held, dt,
+                         std::span<real>(this->m_value.data() + stage.position, n),
+                         std::span<mask>(this->m_clamped.data() + stage.position, n));
+    }
+
+  }; // class ControllerGraph
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Graph.hh
+///
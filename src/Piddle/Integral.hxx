@@ -41,20 +41,192 @@ namespace Piddle
    |                     |___/
   \*/
 
+  //! Class to represent a static integral component
+  template <typename Scalar>
+  class BasicIntegral
+  {
+  private:
+    Scalar m_gain;                     //!< Integral gain
+    Scalar m_integral = Scalar(0.0);   //!< Integral value
+    Scalar m_error    = Scalar(0.0);   //!< Previous error value
+
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+    //! Class constructor
+    BasicIntegral(
+      Scalar gain = Scalar(1.0) //!< Integral gain
+    )
+      : m_gain(gain)
+    {
+    }
+
+    //! Get integral gain const reference
+    Scalar const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get integral gain reference
+    Scalar &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Get integral value const reference
+    Scalar const &
+    value(void) const
+    {
+      return this->m_integral;
+    }
+
+    //! Get integral value reference
+    Scalar &
+    value(void)
+    {
+      return this->m_integral;
+    }
+
+    //! Get previous error value const reference
+    Scalar const &
+    error(void) const
+    {
+      return this->m_error;
+    }
+
+    //! Get previous error value reference
+    Scalar &
+    error(void)
+    {
+      return this->m_error;
+    }
+
+    //! Setup integral component
+    Scalar
+    setup(
+      Scalar error, //!< Input error value
+      Scalar dt     //!< Time step
+    )
+    {
+      return this->m_gain * this->integrate(error, dt);
+    }
+
+    //! Setup integral component over a batch of samples (fused trapezoidal
+    //! recurrence with the state kept in registers)
+    void
+    process(
+      std::span<Scalar const> error, //!< Input error values
+      std::span<Scalar const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    {
+      check_batch(error, dt, out, "BasicIntegral::process");
+      with_time_steps(dt, [this, error, out](auto time_step)
+      {
+        // State is kept in locals that the output stores cannot alias
+        Scalar const   gain     = this->m_gain;
+        Scalar         integral = this->m_integral;
+        Scalar         previous = this->m_error;
+        Scalar const * input    = error.data();
+        Scalar *       output   = out.data();
+        for (std::size_t k = 0; k < error.size(); ++k)
+        {
+          Scalar current = input[k];
+          integral += Scalar(0.5) * (current + previous) * time_step(k);
+          previous  = current;
+          output[k] = gain * integral;
+        }
+        this->m_integral = integral;
+        this->m_error    = previous;
+      });
+    }
+
+    //! Save integral component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_gain);
+      writer.write(this->m_integral);
+      writer.write(this->m_error);
+    }
+
+    //! Restore integral component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_gain);
+      reader.read(this->m_integral);
+      reader.read(this->m_error);
+    }
+
+    //! Reset integral component
+    void
+    reset(void)
+    {
+      this->m_integral = Scalar(0.0);
+      this->m_error    = Scalar(0.0);
+    }
+
+  private:
+    //! Get integral approximation through trapezoidal formula
+    Scalar
+    integrate(
+      Scalar error, //!< Input source value
+      Scalar dt     //!< Time step value
+    )
+    {
+      this->m_integral += Scalar(0.5) * (error + this->m_error) * dt;
+      this->m_error = error;
+      return this->m_integral;
+    }
+
+  }; // class BasicIntegral
+
+  //! Class to represent a removed static integral component
+  template <typename Scalar>
+  class NoIntegral
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Component presence flag
+
+    //! Setup integral component
+    Scalar
+    setup(
+      Scalar, //!< Input error value
+      Scalar  //!< Time step
+    )
+    const
+    {
+      return Scalar(0.0);
+    }
+
+    //! Reset integral component
+    void
+    reset(void)
+    {
+    }
+
+  }; // class NoIntegral
+
   //! Class to represent integral component
   class Integral : public Block
   {
   private:
-    real m_gain;                 //!< Integral gain
-    real m_integral = real(0.0); //!< Integral value
-    real m_error    = real(0.0); //!< Previous error value
+    BasicIntegral<real> m_core; //!< Static integral component
 
   public:
     //! Class constructor
     Integral(
-      real gain //!< Integral gain
+      real gain = real(1.0) //!< Integral gain
     )
-    : m_gain(gain)
+    : m_core(gain)
     {
     }
 
@@ -63,14 +235,42 @@ namespace Piddle
     gain(void)
     const
     {
-      return this->m_gain;
+      return this->m_core.gain();
     }
 
     //! Get integral gain reference
     real &
     gain(void)
     {
-      return this->m_gain;
+      return this->m_core.gain();
+    }
+
+    //! Get integral value const reference
+    real const &
+    value(void) const
+    {
+      return this->m_core.value();
+    }
+
+    //! Get integral value reference
+    real &
+    value(void)
+    {
+      return this->m_core.value();
+    }
+
+    //! Get previous error value const reference
+    real const &
+    error(void) const
+    {
+      return this->m_core.error();
+    }
+
+    //! Get previous error value reference
+    real &
+    error(void)
+    {
+      return this->m_core.error();
     }
 
     //! Setup integral component
@@ -79,33 +279,66 @@ namespace Piddle
       real error, //!< Input error value
       real dt     //!< Time step
     )
-    const override
+    override
     {
       if (this->is_enabled())
-        return this->m_gain * this->integrate(error, dt);
+        return this->m_core.setup(error, dt);
       else
         return real(0.0);
     }
 
+    //! Setup integral component over a batch of samples
+    void
+    process(
+      std::span<real const> error, //!< Input error values
+      std::span<real const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      if (this->is_enabled())
+        this->m_core.process(error, dt, out);
+      else
+      {
+        check_batch(error, dt, out, "Integral::process");
+        std::fill(out.begin(), out.end(), real(0.0));
+      }
+    }
+
+    //! Save integral component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_INTEGRAL);
+      this->m_core.save(writer);
+    }
+
+    //! Restore integral component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_INTEGRAL);
+      this->m_core.restore(reader);
+    }
+
     //! Reset integral component
-    real
+    void
     reset(void) override
     {
-      this->m_integral = real(0.0);
-      this->m_error    = real(0.0);
+      this->m_core.reset();
     };
 
-  private:
-    //! Get integral approximation through trapezoidal formula
-    real
-    integrate(
-      real error, //!< Input source value
-      real dt     //!< Time step value
-    )
+    //! Get a copy of the integral component
+    std::shared_ptr<Block>
+    clone(void) const override
     {
-      this->m_integral += 0.5 * (error + this->m_error) * dt;
-      this->m_error = error;
-      return this->m_integral;
+      return std::make_shared<Integral>(*this);
     }
 
   }; // class Integral
@@ -0,0 +1,265 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: MovingAverage.hh
+///
+
+#ifndef INCLUDE_PIDDLE_MOVINGAVERAGE
+#define INCLUDE_PIDDLE_MOVINGAVERAGE
+
+#include "Block.hxx"
+
+#include <vector>
+
+namespace Piddle
+{
+
+  /*\
+   |   __  __             _                _
+   |  |  \/  | ___ __   _(_)_ __   __ _   / \ __   __ ___ _ __ __ _  __ _  ___
+   |  | |\/| |/ _ \\ \ / / | '_ \ / _` | / _ \\ \ / // _ \ '__/ _` |/ _` |/ _ \
+   |  | |  | | (_) |\ V /| | | | | (_| |/ ___ \\ V /|  __/ | | (_| | (_| |  __/
+   |  |_|  |_|\___/  \_/ |_|_| |_|\__, /_/   \_\\_/  \___|_|  \__,_|\__, |\___|
+   |                              |___/                             |___/
+  \*/
+
+  //! Class to represent a static moving average filter over a window of
+  //! samples. The running sum is updated with Neumaier compensated additions,
+  //! so that every step is O(1) and the round-off does not drift over long
+  //! runs. The window is allocated at construction only.
+  template <typename Scalar>
+  class BasicMovingAverage
+  {
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+  private:
+    std::vector<Scalar> m_window;               //!< Window samples
+    integer             m_index  = 0;           //!< Next sample index
+    integer             m_count  = 0;           //!< Number of valid samples
+    Scalar              m_sum    = Scalar(0.0); //!< Running sum of the window samples
+    Scalar              m_carry  = Scalar(0.0); //!< Running sum compensation term
+    Scalar              m_output = Scalar(0.0); //!< Previous output value
+
+  public:
+    //! Class constructor
+    BasicMovingAverage(
+      integer length = 1 //!< Window length (samples)
+    )
+    {
+      PIDDLE_ASSERT(length > 0,
+        "Piddle::BasicMovingAverage(...): non-positive window length " << length << ".");
+      this->m_window.assign(std::size_t(length), Scalar(0.0));
+    }
+
+    //! Get window length
+    integer
+    length(void) const
+    {
+      return integer(this->m_window.size());
+    }
+
+    //! Get output value const reference
+    Scalar const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Setup moving average filter (the time step is not used)
+    Scalar
+    setup(
+      Scalar input, //!< Input value
+      Scalar        //!< Time step
+    )
+    {
+      integer length = this->length();
+      this->accumulate(-this->m_window[this->m_index]);
+      this->accumulate(input);
+      this->m_window[this->m_index] = input;
+      if (++this->m_index == length)
+        this->m_index = 0;
+      if (this->m_count < length)
+        ++this->m_count;
+      return this->m_output = (this->m_sum + this->m_carry) / Scalar(double(this->m_count));
+    }
+
+    //! Save filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->length());
+      writer.write(std::span<Scalar const>(this->m_window));
+      writer.write(this->m_index);
+      writer.write(this->m_count);
+      writer.write(this->m_sum);
+      writer.write(this->m_carry);
+      writer.write(this->m_output);
+    }
+
+    //! Restore filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      integer length = reader.read<integer>();
+      PIDDLE_ASSERT(length == this->length(),
+        "Piddle::BasicMovingAverage::restore(...): window length " << length << " does not match " << this->length() << ".");
+      std::vector<Scalar> window(this->m_window.size());
+      reader.read(std::span<Scalar>(window));
+      integer index = reader.read<integer>();
+      integer count = reader.read<integer>();
+      Scalar  sum   = reader.read<Scalar>();
+      Scalar  carry = reader.read<Scalar>();
+      Scalar  out   = reader.read<Scalar>();
+      PIDDLE_ASSERT(index >= 0 && index < length && count >= 0 && count <= length,
+        "Piddle::BasicMovingAverage::restore(...): window position " << index << " or count " << count << " out of range.");
+      this->m_window = std::move(window);
+      this->m_index  = index;
+      this->m_count  = count;
+      this->m_sum    = sum;
+      this->m_carry  = carry;
+      this->m_output = out;
+    }
+
+    //! Reset filter component
+    void
+    reset(void)
+    {
+      std::fill(this->m_window.begin(), this->m_window.end(), Scalar(0.0));
+      this->m_index  = 0;
+      this->m_count  = 0;
+      this->m_sum    = Scalar(0.0);
+      this->m_carry  = Scalar(0.0);
+      this->m_output = Scalar(0.0);
+    }
+
+  private:
+    //! Add a value to the running sum, keeping the lost low-order bits in the
+    //! compensation term (Neumaier summation)
+    void
+    accumulate(
+      Scalar value //!< Added value
+    )
+    {
+      Scalar sum = this->m_sum + value;
+      Scalar a   = this->m_sum < Scalar(0.0) ? -this->m_sum : this->m_sum;
+      Scalar b   = value < Scalar(0.0) ? -value : value;
+      this->m_carry += a < b ? (value - sum) + this->m_sum : (this->m_sum - sum) + value;
+      this->m_sum    = sum;
+    }
+
+  }; // class BasicMovingAverage
+
+  //! Class to represent moving average filter
+  class MovingAverage : public Block
+  {
+  private:
+    BasicMovingAverage<real> m_core; //!< Static moving average filter component
+
+  public:
+    //! Class constructor
+    MovingAverage(
+      integer length = 1 //!< Window length (samples)
+    )
+      : m_core(length)
+    {
+    }
+
+    //! Get window length
+    integer
+    length(void) const
+    {
+      return this->m_core.length();
+    }
+
+    //! Get output value const reference
+    real const &
+    output(void) const
+    {
+      return this->m_core.output();
+    }
+
+    //! Setup moving average filter component
+    real
+    setup(
+      real input, //!< Input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      if (this->is_enabled())
+        return this->m_core.setup(input, dt);
+      else
+        return real(0.0);
+    }
+
+    //! Save filter component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_MOVING_AVERAGE);
+      this->m_core.save(writer);
+    }
+
+    //! Restore filter component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_MOVING_AVERAGE);
+      this->m_core.restore(reader);
+    }
+
+    //! Reset filter component
+    void
+    reset(void) override
+    {
+      this->m_core.reset();
+    }
+
+    //! Get a copy of the filter component (with its own window)
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<MovingAverage>(*this);
+    }
+
+  }; // class MovingAverage
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: MovingAverage.hh
+///
@@ -32,6 +32,8 @@
 #include "Integral.hxx"
 #include "Derivative.hxx"
 #include "Antiwindup.hxx"
+#include "TripleBuffer.hxx"
+#include "Telemetry.hxx"
 
 namespace Piddle
 {
@@ -45,50 +47,633 @@ namespace Piddle
    |
   \*/
 
+  //! Class to represent a static pid controller. Components are template
+  //! parameters resolved at compile time (no virtual dispatch), and can be
+  //! removed entirely through the NoProportional, NoIntegral, NoDerivative and
+  //! NoAntiwindup types. Derivative filtering is selected through the filter
+  //! type of the derivative component. Per-step telemetry is recorded through
+  //! the probe type (NoProbe compiles to nothing).
+  template <
+    typename Scalar = real,
+    typename P      = BasicProportional<Scalar>,
+    typename I      = BasicIntegral<Scalar>,
+    typename D      = BasicDerivative<Scalar>,
+    typename AW     = BasicAntiwindup<Scalar>,
+    typename Probe  = NoProbe
+  >
+  class BasicPID
+  {
+  public:
+    typedef Scalar scalar_type; //!< Scalar number type
+
+  private:
+    P      m_proportional;         //!< Proportional component
+    I      m_integral;             //!< Integral component
+    D      m_derivative;           //!< Derivative component
+    AW     m_antiwindup;           //!< Anti-windup component
+    Scalar m_output = Scalar(0.0); //!< Previous unsaturated output value
+
+    [[no_unique_address]] Probe m_probe; //!< Telemetry probe
+
+  public:
+    //! Class constructor
+    BasicPID(
+      P     proportional = P(),    //!< Proportional component
+      I     integral     = I(),    //!< Integral component
+      D     derivative   = D(),    //!< Derivative component
+      AW    antiwindup   = AW(),   //!< Anti-windup component
+      Probe probe        = Probe() //!< Telemetry probe
+    )
+      : m_proportional(proportional), m_integral(integral), m_derivative(derivative), m_antiwindup(antiwindup),
+        m_probe(std::move(probe))
+    {
+    }
+
+    //! Get telemetry probe const reference
+    Probe const &
+    probe(void) const
+    {
+      return this->m_probe;
+    }
+
+    //! Get telemetry probe reference
+    Probe &
+    probe(void)
+    {
+      return this->m_probe;
+    }
+
+    //! Get proportional component const reference
+    P const &
+    proportional(void) const
+    {
+      return this->m_proportional;
+    }
+
+    //! Get proportional component reference
+    P &
+    proportional(void)
+    {
+      return this->m_proportional;
+    }
+
+    //! Get integral component const reference
+    I const &
+    integral(void) const
+    {
+      return this->m_integral;
+    }
+
+    //! Get integral component reference
+    I &
+    integral(void)
+    {
+      return this->m_integral;
+    }
+
+    //! Get derivative component const reference
+    D const &
+    derivative(void) const
+    {
+      return this->m_derivative;
+    }
+
+    //! Get derivative component reference
+    D &
+    derivative(void)
+    {
+      return this->m_derivative;
+    }
+
+    //! Get anti-windup component const reference
+    AW const &
+    antiwindup(void) const
+    {
+      return this->m_antiwindup;
+    }
+
+    //! Get anti-windup component reference
+    AW &
+    antiwindup(void)
+    {
+      return this->m_antiwindup;
+    }
+
+    //! Setup pid controller
+    Scalar
+    setup(
+      Scalar error, //!< Input error value
+      Scalar dt     //!< Time step
+    )
+    {
+      // Unsaturated output (removed components are skipped at compile time)
+      Scalar integration  = this->m_antiwindup.integration(this->m_output);
+      Scalar proportional = this->m_proportional.setup(error, dt);
+      Scalar integral(0.0);
+      Scalar derivative(0.0);
+      Scalar output = proportional;
+      if constexpr (I::ENABLED)
+      {
+        if constexpr (AW::ENABLED)
+          integral = this->m_integral.setup(integration * error, dt);
+        else
+          integral = this->m_integral.setup(error, dt);
+        output = output + integral;
+      }
+      if constexpr (D::ENABLED)
+      {
+        derivative = this->m_derivative.setup(error, dt);
+        output = output + derivative;
+      }
+
+      // Anti-windup routine setup
+      Scalar saturated = output;
+      if constexpr (AW::ENABLED)
+      {
+        this->m_output = output;
+        saturated = this->m_antiwindup.setup(output, dt);
+      }
+
+      // Telemetry recording
+      if constexpr (Probe::ENABLED)
+        this->m_probe.record(error, proportional, integral, derivative, output, saturated,
+                             telemetry_flags(output, saturated, integration));
+      return saturated;
+    }
+
+    //! Save pid controller state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      if constexpr (P::ENABLED)
+        this->m_proportional.save(writer);
+      if constexpr (I::ENABLED)
+        this->m_integral.save(writer);
+      if constexpr (D::ENABLED)
+        this->m_derivative.save(writer);
+      if constexpr (AW::ENABLED)
+        this->m_antiwindup.save(writer);
+      writer.write(this->m_output);
+    }
+
+    //! Restore pid controller state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      if constexpr (P::ENABLED)
+        this->m_proportional.restore(reader);
+      if constexpr (I::ENABLED)
+        this->m_integral.restore(reader);
+      if constexpr (D::ENABLED)
+        this->m_derivative.restore(reader);
+      if constexpr (AW::ENABLED)
+        this->m_antiwindup.restore(reader);
+      reader.read(this->m_output);
+    }
+
+    //! Reset pid controller
+    void
+    reset(void)
+    {
+      this->m_proportional.reset();
+      this->m_integral.reset();
+      this->m_derivative.reset();
+      this->m_antiwindup.reset();
+      this->m_output = Scalar(0.0);
+    }
+
+  }; // class BasicPID
+
+  //! Static proportional-only controller
+  template <typename Scalar = real>
+  using BasicP = BasicPID<Scalar, BasicProportional<Scalar>, NoIntegral<Scalar>, NoDerivative<Scalar>, NoAntiwindup<Scalar>>;
+
+  //! Static proportional-integral controller with anti-windup
+  template <typename Scalar = real>
+  using BasicPI = BasicPID<Scalar, BasicProportional<Scalar>, BasicIntegral<Scalar>, NoDerivative<Scalar>, BasicAntiwindup<Scalar>>;
+
+  //! Static proportional-derivative controller
+  template <typename Scalar = real>
+  using BasicPD = BasicPID<Scalar, BasicProportional<Scalar>, NoIntegral<Scalar>, BasicDerivative<Scalar>, NoAntiwindup<Scalar>>;
+
+  //! Structure to represent a complete pid parameter set
+  struct PIDParameters
+  {
+    real kp    = real(1.0); //!< Proportional gain coefficient
+    real ki    = real(0.0); //!< Integral gain coefficient
+    real kd    = real(0.0); //!< Derivative gain coefficient
+    real fc    = real(0.0); //!< Derivative low-pass filter cutoff frequency
+    real upper = INFTY;     //!< Anti-windup upper bound
+    real lower = -INFTY;    //!< Anti-windup lower bound
+  };
+
   //! Class to represent pid block
   class PID : public Block
   {
+  public:
+    typedef TripleBuffer<PIDParameters> Tuner; //!< Lock-free parameter channel type
+
   private:
-    Proportional m_proportional; //!< Proportional block component
-    Integral     m_integral;     //!< Integral block component
-    Derivative   m_derivative;   //!< Derivative block component
-    Antiwindup   m_antiwindup;   //!< Anti-windup block component
+    Proportional           m_proportional;       //!< Proportional block component
+    Integral               m_integral;           //!< Integral block component
+    Derivative             m_derivative;         //!< Derivative block component
+    Antiwindup             m_antiwindup;         //!< Anti-windup block component
+    real                   m_output = real(0.0); //!< Previous unsaturated output value
+    std::shared_ptr<Tuner> m_tuner;              //!< Lock-free parameter channel
+    bool                   m_bumpless = false;   //!< Bumpless parameter transfer flag
+#ifdef PIDDLE_TELEMETRY
+    RingProbe              m_probe;              //!< Telemetry probe
+#endif
 
   public:
+    //! Class constructor
+    PID(
+      real kp = real(1.0),     //!< Proportional gain coefficient
+      real ki = real(0.0),     //!< Integral gain coefficient
+      real kd = real(0.0),     //!< Derivative gain coefficient
+      real fc = real(0.0),     //!< Derivative low-pass filter cutoff frequency
+      real upper = INFTY,      //!< Anti-windup upper bound
+      real lower = -INFTY      //!< Anti-windup lower bound
+    )
+      : m_proportional(kp), m_integral(ki), m_derivative(kd, fc), m_antiwindup(upper, lower)
+    {
+    }
+
+    //! Class copy constructor (the copy is detached from the parameter channel
+    //! and from the telemetry channel, since they admit a single consumer and
+    //! a single producer respectively)
+    PID(
+      PID const & other //!< Pid block
+    )
+      : Block(other)
+    {
+      *this = other;
+    }
+
+    //! Class move constructor
+    PID(PID &&) = default;
+
+    //! Copy assignment operator (the parameter and telemetry channels are
+    //! detached)
+    PID &
+    operator=(
+      PID const & other //!< Pid block
+    )
+    {
+      if (this != &other)
+      {
+        Block::operator=(other);
+        this->m_proportional = other.m_proportional;
+        this->m_integral     = other.m_integral;
+        this->m_derivative   = other.m_derivative;
+        this->m_antiwindup   = other.m_antiwindup;
+        this->m_output       = other.m_output;
+        this->m_tuner        = nullptr;
+        this->m_bumpless     = other.m_bumpless;
+#ifdef PIDDLE_TELEMETRY
+        this->m_probe        = other.m_probe;
+#endif
+      }
+      return *this;
+    }
+
+    //! Move assignment operator
+    PID & operator=(PID &&) = default;
+
+    //! Get proportional block component const reference
+    Proportional const &
+    proportional(void) const
+    {
+      return this->m_proportional;
+    }
+
+    //! Get proportional block component reference
+    Proportional &
+    proportional(void)
+    {
+      return this->m_proportional;
+    }
+
+    //! Get integral block component const reference
+    Integral const &
+    integral(void) const
+    {
+      return this->m_integral;
+    }
+
+    //! Get integral block component reference
+    Integral &
+    integral(void)
+    {
+      return this->m_integral;
+    }
+
+    //! Get derivative block component const reference
+    Derivative const &
+    derivative(void) const
+    {
+      return this->m_derivative;
+    }
+
+    //! Get derivative block component reference
+    Derivative &
+    derivative(void)
+    {
+      return this->m_derivative;
+    }
+
+    //! Get anti-windup block component const reference
+    Antiwindup const &
+    antiwindup(void) const
+    {
+      return this->m_antiwindup;
+    }
+
+    //! Get anti-windup block component reference
+    Antiwindup &
+    antiwindup(void)
+    {
+      return this->m_antiwindup;
+    }
+
+    //! Get the current parameter set
+    PIDParameters
+    parameters(void) const
+    {
+      PIDParameters out;
+      out.kp    = this->m_proportional.gain();
+      out.ki    = this->m_integral.gain();
+      out.kd    = this->m_derivative.gain();
+      out.fc    = this->m_derivative.filter().cutoff_frequency();
+      out.upper = this->m_antiwindup.upper();
+      out.lower = this->m_antiwindup.lower();
+      return out;
+    }
+
+    //! Set a whole parameter set at once (control thread only). As in the
+    //! constructor, the derivative filter is enabled if and only if the cutoff
+    //! frequency is positive. With bumpless transfer, the integral value is
+    //! rescaled so that the integral term is continuous across an integral
+    //! gain change.
+    void
+    parameters(
+      PIDParameters const & parameters,      //!< Parameter set
+      bool                  bumpless = false //!< Bumpless transfer flag
+    )
+    {
+      real ki = this->m_integral.gain();
+      if (bumpless && ki != parameters.ki && parameters.ki != real(0.0))
+        this->m_integral.value() *= ki / parameters.ki;
+      this->m_proportional.gain()                    = parameters.kp;
+      this->m_integral.gain()                        = parameters.ki;
+      this->m_derivative.gain()                      = parameters.kd;
+      this->m_derivative.filter().cutoff_frequency() = parameters.fc;
+      this->m_derivative.filter().enabling_state()   = parameters.fc > real(0.0);
+      this->m_antiwindup.upper()                     = parameters.upper;
+      this->m_antiwindup.lower()                     = parameters.lower;
+    }
+
+    //! Get the lock-free parameter channel (null if not attached)
+    std::shared_ptr<Tuner> const &
+    tuner(void) const
+    {
+      return this->m_tuner;
+    }
+
+    //! Attach a lock-free parameter channel. A tuning thread publishes whole
+    //! parameter sets through it, and they are applied at the beginning of the
+    //! next setup call without locks or allocations. A null pointer detaches
+    //! the channel.
+    void
+    tuner(
+      std::shared_ptr<Tuner> tuner,           //!< Parameter channel
+      bool                   bumpless = false //!< Bumpless transfer flag
+    )
+    {
+      this->m_tuner    = std::move(tuner);
+      this->m_bumpless = bumpless;
+    }
+
+#ifdef PIDDLE_TELEMETRY
+    //! Get telemetry probe const reference (only with PIDDLE_TELEMETRY)
+    RingProbe const &
+    probe(void) const
+    {
+      return this->m_probe;
+    }
+
+    //! Get telemetry probe reference (only with PIDDLE_TELEMETRY)
+    RingProbe &
+    probe(void)
+    {
+      return this->m_probe;
+    }
+#endif
+
     //! Setup pid component
     real
     setup(
-        real error, //!< Input error value
-        real dt     //!< Time step
+      real error, //!< Input error value
+      real dt     //!< Time step
     )
-        const override
+    override
     {
+      // Pick up retuned parameters at the step boundary
+      if (this->m_tuner && this->m_tuner->update())
+        this->parameters(this->m_tuner->front(), this->m_bumpless);
+
       // Calculate pid components
       if (this->is_enabled())
       {
-        // Unsaturated output
-        real output = this->m_proportional.setup(error, dt) +
-                      this->m_integral.setup(this->m_antiwindup.integration() * error, dt) +
-                      this->m_derivative.setup(error, dt);
+        // Unsaturated output (conditional integration is driven by the
+        // previous unsaturated output)
+        real integration  = this->m_antiwindup.integration(this->m_output);
+        real proportional = this->m_proportional.setup(error, dt);
+        real integral     = this->m_integral.setup(integration * error, dt);
+        real derivative   = this->m_derivative.setup(error, dt);
+        real output       = proportional + integral + derivative;
+        this->m_output = output;
         // Anti-windup routine setup
-        output = this->m_antiwindup.setup(output, dt);
-        return output;
+        real saturated = this->m_antiwindup.setup(output, dt);
+#ifdef PIDDLE_TELEMETRY
+        // Telemetry recording
+        this->m_probe.record(error, proportional, integral, derivative, output, saturated,
+                             telemetry_flags(output, saturated, integration));
+#endif
+        return saturated;
       }
       else
       {
-        return real(0.0)
+        return real(0.0);
+      }
+    }
+
+    //! Setup pid component over a batch of samples. Retuned parameters are
+    //! picked up once at the beginning of the batch, and no telemetry is
+    //! recorded. Results are bit-identical to a loop of setup calls.
+    void
+    process(
+      std::span<real const> error, //!< Input error values
+      std::span<real const> dt,    //!< Time steps (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      check_batch(error, dt, out, "PID::process");
+
+      // Pick up retuned parameters at the batch boundary
+      if (this->m_tuner && this->m_tuner->update())
+        this->parameters(this->m_tuner->front(), this->m_bumpless);
+
+      if (this->is_disabled())
+      {
+        std::fill(out.begin(), out.end(), real(0.0));
+        return;
+      }
+
+      // For a fixed time step and the built-in derivative filter every term is
+      // evaluated in a single fused loop, otherwise the proportional and
+      // derivative terms are first evaluated in chunks through the component
+      // batch methods. In both cases the recurrences run on local copies of the
+      // states, so that the compiler can keep them in registers and overlap
+      // their dependency chains (a disabled anti-windup is equivalent to
+      // infinite bounds)
+      constexpr std::size_t CHUNK = 512;
+      real proportional[CHUNK];
+      real derivative[CHUNK];
+      bool fixed     = dt.size() == 1;
+      bool fused     = fixed && !this->m_derivative.custom_filter();
+      bool scaled    = this->m_proportional.is_enabled();
+      bool active    = this->m_integral.is_enabled();
+      bool slope     = this->m_derivative.is_enabled();
+      bool smoothed  = slope && this->m_derivative.filter().is_enabled();
+      bool clamped   = this->m_antiwindup.is_enabled();
+      real kp        = this->m_proportional.gain();
+      real ki        = this->m_integral.gain();
+      real kd        = this->m_derivative.gain();
+      real integral  = this->m_integral.value();
+      real previous  = this->m_integral.error();
+      real last      = this->m_derivative.error();
+      real filtered  = this->m_derivative.filter().output();
+      real alpha     = fused && smoothed ? this->m_derivative.filter().coefficient(dt[0]) : real(0.0);
+      real upper     = clamped ? this->m_antiwindup.upper() : INFTY;
+      real lower     = clamped ? this->m_antiwindup.lower() : -INFTY;
+      real output    = this->m_output;
+      std::size_t n  = fused ? error.size() : std::min(CHUNK, error.size());
+      for (std::size_t base = 0; base < error.size(); base += n)
+      {
+        n = std::min(n, error.size() - base);
+        real const * input = error.data() + base;
+        real const * steps = fixed ? dt.data() : dt.data() + base;
+        if (!fused)
+        {
+          std::span<real const> chunk(input, n);
+          std::span<real const> chunk_dt(steps, fixed ? 1 : n);
+          this->m_proportional.process(chunk, chunk_dt, std::span<real>(proportional, n));
+          this->m_derivative.process(chunk, chunk_dt, std::span<real>(derivative, n));
+        }
+        for (std::size_t k = 0; k < n; ++k)
+        {
+          real e    = input[k];
+          real h    = fixed ? steps[0] : steps[k];
+          real p    = real(0.0);
+          real i    = real(0.0);
+          real d    = real(0.0);
+          if (fused)
+          {
+            if (scaled)
+              p = kp * e;
+            if (slope)
+            {
+              d    = (e - last) / h;
+              last = e;
+              if (smoothed)
+                d = filtered += (d - filtered) * alpha;
+              d = kd * d;
+            }
+          }
+          else
+          {
+            p = proportional[k];
+            d = derivative[k];
+          }
+          if (active)
+          {
+            real current = e;
+            if (output > upper || output < lower)
+              current *= real(0.0);
+            integral += real(0.5) * (current + previous) * h;
+            previous  = current;
+            i         = ki * integral;
+          }
+          output = p + i + d;
+          out[base + k] = std::min(std::max(output, lower), upper);
+        }
       }
+      this->m_integral.value() = integral;
+      this->m_integral.error() = previous;
+      if (fused && slope)
+      {
+        this->m_derivative.error() = last;
+        if (smoothed)
+          this->m_derivative.filter().output() = filtered;
+      }
+      this->m_output = output;
+    }
+
+    //! Save pid components state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_PID);
+      writer.write(this->m_output);
+      writer.write(std::uint8_t(this->m_bumpless ? 1 : 0));
+      this->m_proportional.save(writer);
+      this->m_integral.save(writer);
+      this->m_derivative.save(writer);
+      this->m_antiwindup.save(writer);
+    }
+
+    //! Restore pid components state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_PID);
+      reader.read(this->m_output);
+      this->m_bumpless = reader.read<std::uint8_t>() != 0;
+      this->m_proportional.restore(reader);
+      this->m_integral.restore(reader);
+      this->m_derivative.restore(reader);
+      this->m_antiwindup.restore(reader);
     }
 
     //! Reset pid components
-    real
-    reset(void)
-        override
+    void
+    reset(void) override
     {
-      this->m_filter.reset();
       this->m_proportional.reset();
       this->m_integral.reset();
       this->m_derivative.reset();
+      this->m_antiwindup.reset();
+      this->m_output = real(0.0);
+    }
+
+    //! Get a copy of the pid components (detached from the parameter channel)
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<PID>(*this);
     }
 
   }; // class PID
@@ -0,0 +1,1016 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: PidBank.hh
+///
+
+#ifndef INCLUDE_PIDDLE_PIDBANK
+#define INCLUDE_PIDDLE_PIDBANK
+
+#include "Pid.hxx"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Piddle
+{
+
+  /*\
+   |   ____  ___ ____  ____              _
+   |  |  _ \|_ _|  _ \| __ )  __ _ _ __ | | __
+   |  | |_) || || | | |  _ \ / _` | '_ \| |/ /
+   |  |  __/ | || |_| | |_) | (_| | | | |   <
+   |  |_|   |___|____/|____/ \__,_|_| |_|_|\_\
+   |
+  \*/
+
+  //! Class to represent a bank of independent pid loops stored as a
+  //! structure-of-arrays. Each lane reproduces the PID block step bit for bit
+  //! (provided that floating-point contraction is disabled, e.g. through the
+  //! -ffp-contract=off flag, since the scalar path could be fused otherwise).
+  //! Lanes are stepped with AVX-512, AVX2 or SSE2 kernels when available at
+  //! compile time, and with a scalar loop otherwise. Component enabling
+  //! states are stored as per-lane bit masks, so that the kernels are
+  //! branchless.
+  class PIDBank
+  {
+  public:
+    typedef std::uint64_t mask; //!< Lane mask type (all bits set if enabled)
+
+    //! Enumeration of the lane components
+    enum Component : integer
+    {
+      LOOP = 0,         //!< Whole pid loop
+      PROPORTIONAL = 1, //!< Proportional component
+      INTEGRAL = 2,     //!< Integral component
+      DERIVATIVE = 3,   //!< Derivative component
+      FILTER = 4,       //!< Derivative low-pass filter component
+      ANTIWINDUP = 5,   //!< Anti-windup component
+      COMPONENTS = 6    //!< Number of components
+    };
+
+  private:
+    static_assert(sizeof(mask) == sizeof(real), "PIDBank lane masks must match the real type width");
+
+    static constexpr mask MASK_ON  = ~mask(0); //!< Enabled lane mask
+    static constexpr mask MASK_OFF = mask(0);  //!< Disabled lane mask
+
+    integer m_size = 0; //!< Number of lanes
+
+    // Parameters
+    std::vector<real> m_kp;    //!< Proportional gain coefficients
+    std::vector<real> m_ki;    //!< Integral gain coefficients
+    std::vector<real> m_kd;    //!< Derivative gain coefficients
+    std::vector<real> m_fc;    //!< Derivative low-pass filter cutoff frequencies
+    std::vector<real> m_upper; //!< Anti-windup upper bounds
+    std::vector<real> m_lower; //!< Anti-windup lower bounds
+
+    // States
+    std::vector<real> m_integral;      //!< Integral values
+    std::vector<real> m_error;         //!< Previous integrated error values
+    std::vector<real> m_error_old;     //!< Previous derivative error values
+    std::vector<real> m_filter_output; //!< Previous derivative filter output values
+    std::vector<real> m_output;        //!< Previous unsaturated output values
+
+    // Derivative filter coefficients cache
+    std::vector<real> m_alpha;                 //!< Filter coefficients
+    std::vector<real> m_alpha_dt;              //!< Time steps of the cached filter coefficients (NaN if stale)
+    real              m_alpha_all = QUIET_NAN; //!< Time step of all the cached filter coefficients (NaN if not shared)
+
+    // Enabling states
+    std::vector<mask> m_enabled[COMPONENTS]; //!< Component enabling masks
+
+  public:
+    //! Class constructor
+    PIDBank(void)
+    {
+    }
+
+    //! Class constructor
+    PIDBank(
+      integer size,             //!< Number of lanes
+      PID const & pid = PID()   //!< Pid block used to initialize the lanes
+    )
+    {
+      this->resize(size, pid);
+    }
+
+    //! Get the number of lanes
+    integer
+    size(void) const
+    {
+      return this->m_size;
+    }
+
+    //! Resize the bank, new lanes are initialized from the input pid block
+    void
+    resize(
+      integer size,           //!< Number of lanes
+      PID const & pid = PID() //!< Pid block used to initialize the new lanes
+    )
+    {
+      PIDDLE_ASSERT(size >= 0, "Piddle::PIDBank::resize(...): negative size " << size << ".");
+      integer old_size = this->m_size;
+      std::size_t n = std::size_t(size);
+      for (std::vector<real> * v : {&this->m_kp, &this->m_ki, &this->m_kd, &this->m_fc, &this->m_upper,
+                                    &this->m_lower, &this->m_integral, &this->m_error, &this->m_error_old,
+                                    &this->m_filter_output, &this->m_output, &this->m_alpha})
+        v->resize(n, real(0.0));
+      this->m_alpha_dt.resize(n, QUIET_NAN);
+      for (integer c = 0; c < COMPONENTS; ++c)
+        this->m_enabled[c].resize(n, MASK_OFF);
+      this->m_size = size;
+      for (integer i = old_size; i < size; ++i)
+        this->assign(i, pid);
+    }
+
+    //! Append a lane initialized from the input pid block
+    void
+    push_back(
+      PID const & pid //!< Pid block used to initialize the lane
+    )
+    {
+      this->resize(this->m_size + 1, pid);
+    }
+
+    //! Copy the parameters and enabling states of a pid block into a lane,
+    //! lane internal states are reset
+    void
+    assign(
+      integer     i,  //!< Lane index
+      PID const & pid //!< Pid block
+    )
+    {
+      this->check(i, "assign");
+      PIDDLE_ASSERT(!pid.derivative().custom_filter(),
+        "Piddle::PIDBank::assign(...): custom derivative filters are not supported by the bank lanes.");
+      this->m_kp[i]    = pid.proportional().gain();
+      this->m_ki[i]    = pid.integral().gain();
+      this->m_kd[i]    = pid.derivative().gain();
+      this->m_fc[i]    = pid.derivative().filter().cutoff_frequency();
+      this->m_upper[i] = pid.antiwindup().upper();
+      this->m_lower[i] = pid.antiwindup().lower();
+      this->enabling_state(i, LOOP, pid.is_enabled());
+      this->enabling_state(i, PROPORTIONAL, pid.proportional().is_enabled());
+      this->enabling_state(i, INTEGRAL, pid.integral().is_enabled());
+      this->enabling_state(i, DERIVATIVE, pid.derivative().is_enabled());
+      this->enabling_state(i, FILTER, pid.derivative().filter().is_enabled());
+      this->enabling_state(i, ANTIWINDUP, pid.antiwindup().is_enabled());
+      this->invalidate(i);
+      this->reset(i);
+    }
+
+    //! Get a pid block with the parameters and enabling states of a lane
+    //! (lane internal states are not copied)
+    PID
+    lane(
+      integer i //!< Lane index
+    )
+    const
+    {
+      this->check(i, "lane");
+      PID pid;
+      pid.parameters(this->parameters(i));
+      pid.enabling_state()                       = this->is_enabled(i, LOOP);
+      pid.proportional().enabling_state()        = this->is_enabled(i, PROPORTIONAL);
+      pid.integral().enabling_state()            = this->is_enabled(i, INTEGRAL);
+      pid.derivative().enabling_state()          = this->is_enabled(i, DERIVATIVE);
+      pid.derivative().filter().enabling_state() = this->is_enabled(i, FILTER);
+      pid.antiwindup().enabling_state()          = this->is_enabled(i, ANTIWINDUP);
+      return pid;
+    }
+
+    //! Get lane parameter set
+    PIDParameters
+    parameters(
+      integer i //!< Lane index
+    )
+    const
+    {
+      this->check(i, "parameters");
+      PIDParameters out;
+      out.kp    = this->m_kp[i];
+      out.ki    = this->m_ki[i];
+      out.kd    = this->m_kd[i];
+      out.fc    = this->m_fc[i];
+      out.upper = this->m_upper[i];
+      out.lower = this->m_lower[i];
+      return out;
+    }
+
+    //! Set lane parameter set. As in the pid block, the derivative filter is
+    //! enabled if and only if the cutoff frequency is positive, and with
+    //! bumpless transfer the integral value is rescaled.
+    void
+    parameters(
+      integer               i,               //!< Lane index
+      PIDParameters const & parameters,      //!< Parameter set
+      bool                  bumpless = false //!< Bumpless transfer flag
+    )
+    {
+      this->check(i, "parameters");
+      real ki = this->m_ki[i];
+      if (bumpless && ki != parameters.ki && parameters.ki != real(0.0))
+        this->m_integral[i] *= ki / parameters.ki;
+      this->m_kp[i]    = parameters.kp;
+      this->m_ki[i]    = parameters.ki;
+      this->m_kd[i]    = parameters.kd;
+      this->m_fc[i]    = parameters.fc;
+      this->m_upper[i] = parameters.upper;
+      this->m_lower[i] = parameters.lower;
+      this->invalidate(i);
+      this->enabling_state(i, FILTER, parameters.fc > real(0.0));
+    }
+
+    //! Get lane proportional gain const reference
+    real const &
+    proportional_gain(integer i) const
+    {
+      return this->m_kp[i];
+    }
+
+    //! Get lane proportional gain reference
+    real &
+    proportional_gain(integer i)
+    {
+      return this->m_kp[i];
+    }
+
+    //! Get lane integral gain const reference
+    real const &
+    integral_gain(integer i) const
+    {
+      return this->m_ki[i];
+    }
+
+    //! Get lane integral gain reference
+    real &
+    integral_gain(integer i)
+    {
+      return this->m_ki[i];
+    }
+
+    //! Get lane derivative gain const reference
+    real const &
+    derivative_gain(integer i) const
+    {
+      return this->m_kd[i];
+    }
+
+    //! Get lane derivative gain reference
+    real &
+    derivative_gain(integer i)
+    {
+      return this->m_kd[i];
+    }
+
+    //! Get lane derivative low-pass filter cut-off frequency const reference
+    real const &
+    cutoff_frequency(integer i) const
+    {
+      return this->m_fc[i];
+    }
+
+    //! Get lane derivative low-pass filter cut-off frequency reference
+    //! (invalidates the filter coefficients cache)
+    real &
+    cutoff_frequency(integer i)
+    {
+      this->invalidate(i);
+      return this->m_fc[i];
+    }
+
+    //! Get lane anti-windup upper bound const reference
+    real const &
+    upper(integer i) const
+    {
+      return this->m_upper[i];
+    }
+
+    //! Get lane anti-windup upper bound reference
+    real &
+    upper(integer i)
+    {
+      return this->m_upper[i];
+    }
+
+    //! Get lane anti-windup lower bound const reference
+    real const &
+    lower(integer i) const
+    {
+      return this->m_lower[i];
+    }
+
+    //! Get lane anti-windup lower bound reference
+    real &
+    lower(integer i)
+    {
+      return this->m_lower[i];
+    }
+
+    //! Check if a lane component is enabled
+    bool
+    is_enabled(
+      integer   i,           //!< Lane index
+      Component c = LOOP     //!< Lane component
+    ) const
+    {
+      return this->m_enabled[c][i] != MASK_OFF;
+    }
+
+    //! Check if a lane component is disabled
+    bool
+    is_disabled(
+      integer   i,           //!< Lane index
+      Component c = LOOP     //!< Lane component
+    ) const
+    {
+      return this->m_enabled[c][i] == MASK_OFF;
+    }
+
+    //! Set a lane component enabling state
+    void
+    enabling_state(
+      integer   i,      //!< Lane index
+      Component c,      //!< Lane component
+      bool      enabled //!< Enabling state
+    )
+    {
+      this->m_enabled[c][i] = enabled ? MASK_ON : MASK_OFF;
+    }
+
+    //! Enable a lane component
+    void
+    enable(
+      integer   i,       //!< Lane index
+      Component c = LOOP //!< Lane component
+    )
+    {
+      this->enabling_state(i, c, true);
+    }
+
+    //! Disable a lane component
+    void
+    disable(
+      integer   i,       //!< Lane index
+      Component c = LOOP //!< Lane component
+    )
+    {
+      this->enabling_state(i, c, false);
+    }
+
+    //! Check if a lane output was saturated by the anti-windup at the last step
+    bool
+    is_saturated(
+      integer i //!< Lane index
+    )
+    const
+    {
+      real u       = this->m_output[i];
+      bool limited = (this->m_enabled[LOOP][i] & this->m_enabled[ANTIWINDUP][i]) != MASK_OFF;
+      return limited & ((u > this->m_upper[i]) | (u < this->m_lower[i]));
+    }
+
+    //! Save all lanes parameters, enabling states and internal states (arrays
+    //! are written in bulk)
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(std::uint8_t(STATE_PID_BANK));
+      writer.write(this->m_size);
+      for (std::vector<real> const * v : {&this->m_kp, &this->m_ki, &this->m_kd, &this->m_fc, &this->m_upper,
+                                          &this->m_lower, &this->m_integral, &this->m_error, &this->m_error_old,
+                                          &this->m_filter_output, &this->m_output})
+        writer.write(std::span<real const>(*v));
+      for (integer c = 0; c < COMPONENTS; ++c)
+        writer.write(std::span<mask const>(this->m_enabled[c]));
+    }
+
+    //! Restore all lanes parameters, enabling states and internal states (the
+    //! bank is resized to the saved number of lanes)
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.expect(STATE_PID_BANK);
+      integer size = reader.read<integer>();
+      PIDDLE_ASSERT(size >= 0, "Piddle::PIDBank::restore(...): negative size " << size << ".");
+      this->resize(size);
+      for (std::vector<real> * v : {&this->m_kp, &this->m_ki, &this->m_kd, &this->m_fc, &this->m_upper,
+                                    &this->m_lower, &this->m_integral, &this->m_error, &this->m_error_old,
+                                    &this->m_filter_output, &this->m_output})
+        reader.read(std::span<real>(*v));
+      for (integer c = 0; c < COMPONENTS; ++c)
+        reader.read(std::span<mask>(this->m_enabled[c]));
+      std::fill(this->m_alpha_dt.begin(), this->m_alpha_dt.end(), QUIET_NAN);
+      this->m_alpha_all = QUIET_NAN;
+    }
+
+    //! Reset all lanes internal states
+    void
+    reset(void)
+    {
+      for (integer i = 0; i < this->m_size; ++i)
+        this->reset(i);
+    }
+
+    //! Reset lane internal states
+    void
+    reset(
+      integer i //!< Lane index
+    )
+    {
+      this->m_integral[i]      = real(0.0);
+      this->m_error[i]         = real(0.0);
+      this->m_error_old[i]     = real(0.0);
+      this->m_filter_output[i] = real(0.0);
+      this->m_output[i]        = real(0.0);
+    }
+
+    //! Setup all the lanes and calculate their outputs
+    void
+    setup(
+      std::span<real const> errors, //!< Input error values (one per lane)
+      real                  dt,     //!< Time step
+      std::span<real>       out     //!< Output values (one per lane)
+    )
+    {
+      PIDDLE_ASSERT(errors.size() == std::size_t(this->m_size),
+        "Piddle::PIDBank::setup(...): errors size " << errors.size() << " does not match bank size " << this->m_size << ".");
+      this->setup(0, errors, std::span<mask const>(), dt, out);
+    }
+
+    //! Setup a contiguous range of lanes and calculate their outputs. Lanes
+    //! with a set hold mask freeze their integrators as if their outputs were
+    //! saturated (e.g. for cascade tracking), an empty hold span holds no lane.
+    //! The saturation masks of the lanes at this step are optionally returned.
+    void
+    setup(
+      integer               first,         //!< First lane index
+      std::span<real const> errors,        //!< Input error values (one per lane of the range)
+      std::span<mask const> hold,          //!< Integrator hold masks (one per lane of the range, or empty)
+      real                  dt,            //!< Time step
+      std::span<real>       out,           //!< Output values (one per lane of the range)
+      std::span<mask>       saturated = {} //!< Saturation masks (one per lane of the range, or empty)
+    )
+    {
+      PIDDLE_ASSERT(out.size() == errors.size(),
+        "Piddle::PIDBank::setup(...): outputs size " << out.size() << " does not match errors size " << errors.size() << ".");
+      this->setup_range(first, errors.data(), nullptr, hold, dt, out, saturated);
+    }
+
+    //! Setup a contiguous range of lanes gathering their input errors from an
+    //! array of values (the error of the k-th lane of the range is the value
+    //! at the k-th source index), otherwise as the setup of a lane range.
+    void
+    setup(
+      integer                  first,         //!< First lane index
+      std::span<real const>    values,        //!< Values the errors are gathered from
+      std::span<integer const> sources,       //!< Error value indices (one per lane of the range)
+      std::span<mask const>    hold,          //!< Integrator hold masks (one per lane of the range, or empty)
+      real                     dt,            //!< Time step
+      std::span<real>          out,           //!< Output values (one per lane of the range)
+      std::span<mask>          saturated = {} //!< Saturation masks (one per lane of the range, or empty)
+    )
+    {
+      PIDDLE_ASSERT(out.size() == sources.size(),
+        "Piddle::PIDBank::setup(...): outputs size " << out.size() << " does not match sources size " << sources.size() << ".");
+      for (integer source : sources)
+        PIDDLE_ASSERT(source >= 0 && std::size_t(source) < values.size(),
+          "Piddle::PIDBank::setup(...): source index " << source << " out of range [0," << values.size() << ").");
+      this->setup_range(first, values.data(), sources.data(), hold, dt, out, saturated);
+    }
+
+    //! Update the derivative filter coefficients of all the lanes for a time
+    //! step, so that the next setup calls find them cached (lane range setup
+    //! calls otherwise check and update the coefficients of their own lanes)
+    void
+    prepare(
+      real dt //!< Time step
+    )
+    {
+      if (!(dt == this->m_alpha_all))
+        this->update(0, this->m_size, dt);
+    }
+
+  private:
+    //! Check lane index
+    void
+    check(
+      integer      i,    //!< Lane index
+      char const * where //!< Calling method name
+    ) const
+    {
+      PIDDLE_ASSERT(i >= 0 && i < this->m_size,
+        "Piddle::PIDBank::" << where << "(...): lane index " << i << " out of range [0," << this->m_size << ").");
+    }
+
+    //! Invalidate the cached filter coefficient of a lane
+    void
+    invalidate(
+      integer i //!< Lane index
+    )
+    {
+      this->m_alpha_dt[i] = QUIET_NAN;
+      this->m_alpha_all   = QUIET_NAN;
+    }
+
+    //! Update the filter coefficients of a lane range not cached for a time
+    //! step (recomputed only when the time step or the cut-off changes)
+    void
+    update(
+      integer first, //!< First lane index
+      integer end,   //!< End lane index
+      real    dt     //!< Time step
+    )
+    {
+      for (integer i = first; i < end; ++i)
+      {
+        if (!(dt == this->m_alpha_dt[i]))
+        {
+          this->m_alpha[i]    = 1.0 - std::exp(-dt * 2.0 * PI * this->m_fc[i]);
+          this->m_alpha_dt[i] = dt;
+        }
+      }
+      if (first == 0 && end == this->m_size)
+        this->m_alpha_all = dt;
+    }
+
+    //! Setup a contiguous range of lanes, with the input errors either in
+    //! lane order or gathered through source indices
+    void
+    setup_range(
+      integer               first,    //!< First lane index
+      real const *          error,    //!< Input error values (or values the errors are gathered from)
+      integer const *       source,   //!< Error value indices (null if the errors are in lane order)
+      std::span<mask const> hold,     //!< Integrator hold masks (one per lane of the range, or empty)
+      real                  dt,       //!< Time step
+      std::span<real>       out,      //!< Output values (one per lane of the range)
+      std::span<mask>       saturated //!< Saturation masks (one per lane of the range, or empty)
+    )
+    {
+      integer end = first + integer(out.size());
+      PIDDLE_ASSERT(first >= 0 && end <= this->m_size,
+        "Piddle::PIDBank::setup(...): lanes range [" << first << "," << end << ") out of range [0," << this->m_size << ").");
+      PIDDLE_ASSERT(hold.empty() || hold.size() == out.size(),
+        "Piddle::PIDBank::setup(...): hold masks size " << hold.size() << " does not match outputs size " << out.size() << ".");
+      PIDDLE_ASSERT(saturated.empty() || saturated.size() == out.size(),
+        "Piddle::PIDBank::setup(...): saturation masks size " << saturated.size() << " does not match outputs size " << out.size() << ".");
+
+      // Filter coefficients are recomputed only when the time step changes
+      if (!(dt == this->m_alpha_all))
+        this->update(first, end, dt);
+
+      mask const * held    = hold.empty() ? nullptr : hold.data();
+      mask *       limited = saturated.empty() ? nullptr : saturated.data();
+      integer      i       = first;
+      // The kernels below round every product and sum as PID::setup does, so
+      // the lanes are bit exact only if the translation unit is compiled with
+      // -ffp-contract=off (the compiler may fuse them into FMAs otherwise)
+#if defined(__AVX512F__)
+      i = this->setup_avx512(first, end, error, source, held, dt, out.data(), limited);
+#elif defined(__AVX2__)
+      i = this->setup_avx2(first, end, error, source, held, dt, out.data(), limited);
+#elif defined(__SSE2__)
+      i = this->setup_sse2(first, end, error, source, held, dt, out.data(), limited);
+#endif
+      integer done = i - first;
+      if (source == nullptr)
+        error += done;
+      else
+        source += done;
+      this->setup_scalar(i, end, error, source, held != nullptr ? held + done : nullptr, dt, out.data() + done,
+                         limited != nullptr ? limited + done : nullptr);
+    }
+
+    //! Scalar lanes kernel (the input and output arrays start at the first
+    //! lane). Saturation dependent choices are evaluated without branches,
+    //! since they are data dependent and hardly predictable.
+    void
+    setup_scalar(
+      integer         begin,     //!< First lane index
+      integer         end,       //!< End lane index
+      real const *    error,     //!< Input error values (or values the errors are gathered from)
+      integer const * source,    //!< Error value indices (null if the errors are in lane order)
+      mask const *    hold,      //!< Integrator hold masks (null if no lane is held)
+      real            dt,        //!< Time step
+      real *          out,       //!< Output values
+      mask *          saturated  //!< Saturation masks (null if not required)
+    )
+    {
+      mask const * en = this->m_enabled[LOOP].data();
+      mask const * ep = this->m_enabled[PROPORTIONAL].data();
+      mask const * ei = this->m_enabled[INTEGRAL].data();
+      mask const * ed = this->m_enabled[DERIVATIVE].data();
+      mask const * ef = this->m_enabled[FILTER].data();
+      mask const * ea = this->m_enabled[ANTIWINDUP].data();
+      for (integer i = begin; i < end; ++i)
+      {
+        integer k = i - begin;
+        if (en[i] == MASK_OFF)
+        {
+          out[k] = real(0.0);
+          if (saturated != nullptr)
+            saturated[k] = MASK_OFF;
+          continue;
+        }
+        real e     = source != nullptr ? error[source[k]] : error[k];
+        real upper = this->m_upper[i];
+        real lower = this->m_lower[i];
+
+        // Proportional
+        real p = ep[i] != MASK_OFF ? this->m_kp[i] * e : real(0.0);
+
+        // Conditional integration
+        real u_old  = this->m_output[i];
+        bool windup = (ea[i] != MASK_OFF) & ((u_old > upper) | (u_old < lower));
+        if (hold != nullptr)
+          windup |= hold[k] != MASK_OFF;
+        real factor = static_cast<real>(!windup);
+        real e_int  = factor * e;
+        real in     = real(0.0);
+        if (ei[i] != MASK_OFF)
+        {
+          this->m_integral[i] += 0.5 * (e_int + this->m_error[i]) * dt;
+          this->m_error[i] = e_int;
+          in = this->m_ki[i] * this->m_integral[i];
+        }
+
+        // Derivative
+        real d = real(0.0);
+        if (ed[i] != MASK_OFF)
+        {
+          real diff = (e - this->m_error_old[i]) / dt;
+          if (ef[i] != MASK_OFF)
+            diff = this->m_filter_output[i] += (diff - this->m_filter_output[i]) * this->m_alpha[i];
+          this->m_error_old[i] = e;
+          d = this->m_kd[i] * diff;
+        }
+
+        // Output saturation (flags are combined without short-circuits, since
+        // saturations are data dependent and would make the branches
+        // unpredictable)
+        real u = p + in + d;
+        this->m_output[i] = u;
+        if (saturated != nullptr)
+          saturated[k] = ((ea[i] != MASK_OFF) & ((u > upper) | (u < lower))) ? MASK_ON : MASK_OFF;
+        if (ea[i] != MASK_OFF)
+        {
+          u = u < lower ? lower : u;
+          u = upper < u ? upper : u;
+        }
+        out[k] = u;
+      }
+    }
+
+#if defined(__AVX512F__)
+    //! AVX-512 lanes kernel (the input and output arrays start at the first
+    //! lane), returns the index of the first unprocessed lane
+    integer
+    setup_avx512(
+      integer         begin,     //!< First lane index
+      integer         end,       //!< End lane index
+      real const *    error,     //!< Input error values (or values the errors are gathered from)
+      integer const * source,    //!< Error value indices (null if the errors are in lane order)
+      mask const *    hold,      //!< Integrator hold masks (null if no lane is held)
+      real            dt,        //!< Time step
+      real *          out,       //!< Output values
+      mask *          saturated  //!< Saturation masks (null if not required)
+    )
+    {
+      static_assert(sizeof(real) == sizeof(double), "PIDBank AVX-512 kernel requires double precision");
+      __m512d const v_dt   = _mm512_set1_pd(dt);
+      __m512d const v_half = _mm512_set1_pd(0.5);
+      __m512d const v_zero = _mm512_setzero_pd();
+      __m512d const v_one  = _mm512_set1_pd(1.0);
+      integer i = begin;
+      for (; i + 8 <= end; i += 8)
+      {
+        integer k = i - begin;
+        __mmask8 en = this->load_mask_avx512(LOOP, i);
+        __mmask8 ep = this->load_mask_avx512(PROPORTIONAL, i) & en;
+        __mmask8 ei = this->load_mask_avx512(INTEGRAL, i) & en;
+        __mmask8 ed = this->load_mask_avx512(DERIVATIVE, i) & en;
+        __mmask8 ef = this->load_mask_avx512(FILTER, i) & ed;
+        __mmask8 ea = this->load_mask_avx512(ANTIWINDUP, i);
+
+        __m512d e     = source != nullptr ? _mm512_set_pd(error[source[k + 7]], error[source[k + 6]], error[source[k + 5]],
+                                                          error[source[k + 4]], error[source[k + 3]], error[source[k + 2]],
+                                                          error[source[k + 1]], error[source[k]])
+                                          : _mm512_loadu_pd(error + k);
+        __m512d upper = _mm512_loadu_pd(this->m_upper.data() + i);
+        __m512d lower = _mm512_loadu_pd(this->m_lower.data() + i);
+
+        // Proportional
+        __m512d p = _mm512_maskz_mul_pd(ep, _mm512_loadu_pd(this->m_kp.data() + i), e);
+
+        // Conditional integration
+        __m512d  u_old  = _mm512_loadu_pd(this->m_output.data() + i);
+        __mmask8 clamp  = ea & (_mm512_cmp_pd_mask(u_old, upper, _CMP_GT_OQ) | _mm512_cmp_pd_mask(u_old, lower, _CMP_LT_OQ));
+        if (hold != nullptr)
+          clamp |= this->load_mask_avx512(hold + k);
+        __m512d  factor = _mm512_mask_blend_pd(clamp, v_one, v_zero);
+        __m512d  e_int  = _mm512_mul_pd(factor, e);
+        __m512d  integ  = _mm512_loadu_pd(this->m_integral.data() + i);
+        __m512d  e_prev = _mm512_loadu_pd(this->m_error.data() + i);
+        integ = _mm512_mask_add_pd(integ, ei, integ, _mm512_mul_pd(_mm512_mul_pd(v_half, _mm512_add_pd(e_int, e_prev)), v_dt));
+        _mm512_storeu_pd(this->m_integral.data() + i, integ);
+        _mm512_storeu_pd(this->m_error.data() + i, _mm512_mask_blend_pd(ei, e_prev, e_int));
+        __m512d in = _mm512_maskz_mul_pd(ei, _mm512_loadu_pd(this->m_ki.data() + i), integ);
+
+        // Derivative
+        __m512d e_old = _mm512_loadu_pd(this->m_error_old.data() + i);
+        __m512d diff  = _mm512_div_pd(_mm512_sub_pd(e, e_old), v_dt);
+        __m512d y_old = _mm512_loadu_pd(this->m_filter_output.data() + i);
+        __m512d y     = _mm512_add_pd(y_old, _mm512_mul_pd(_mm512_sub_pd(diff, y_old), _mm512_loadu_pd(this->m_alpha.data() + i)));
+        _mm512_storeu_pd(this->m_filter_output.data() + i, _mm512_mask_blend_pd(ef, y_old, y));
+        diff = _mm512_mask_blend_pd(ef, diff, y);
+        _mm512_storeu_pd(this->m_error_old.data() + i, _mm512_mask_blend_pd(ed, e_old, e));
+        __m512d d = _mm512_maskz_mul_pd(ed, _mm512_loadu_pd(this->m_kd.data() + i), diff);
+
+        // Output saturation
+        __m512d u = _mm512_add_pd(_mm512_add_pd(p, in), d);
+        _mm512_storeu_pd(this->m_output.data() + i, _mm512_mask_blend_pd(en, u_old, u));
+        if (saturated != nullptr)
+        {
+          __mmask8 limit = en & ea & (_mm512_cmp_pd_mask(u, upper, _CMP_GT_OQ) | _mm512_cmp_pd_mask(u, lower, _CMP_LT_OQ));
+          _mm512_storeu_si512(saturated + k, _mm512_maskz_set1_epi64(limit, -1));
+        }
+        __m512d sat = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(u, lower, _CMP_LT_OQ), u, lower);
+        sat = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(u, upper, _CMP_GT_OQ), sat, upper);
+        u = _mm512_mask_blend_pd(ea, u, sat);
+        _mm512_storeu_pd(out + k, _mm512_maskz_mov_pd(en, u));
+      }
+      return i;
+    }
+
+    //! Load eight lane masks of a component as an AVX-512 mask register
+    __mmask8
+    load_mask_avx512(
+      Component c, //!< Lane component
+      integer   i  //!< First lane index
+    ) const
+    {
+      return this->load_mask_avx512(this->m_enabled[c].data() + i);
+    }
+
+    //! Load eight lane masks as an AVX-512 mask register
+    __mmask8
+    load_mask_avx512(
+      mask const * masks //!< Lane masks
+    ) const
+    {
+      __m512i m = _mm512_loadu_si512(masks);
+      return _mm512_test_epi64_mask(m, m);
+    }
+#endif
+
+#if defined(__AVX2__)
+    //! AVX2 lanes kernel (the input and output arrays start at the first
+    //! lane), returns the index of the first unprocessed lane
+    integer
+    setup_avx2(
+      integer         begin,     //!< First lane index
+      integer         end,       //!< End lane index
+      real const *    error,     //!< Input error values (or values the errors are gathered from)
+      integer const * source,    //!< Error value indices (null if the errors are in lane order)
+      mask const *    hold,      //!< Integrator hold masks (null if no lane is held)
+      real            dt,        //!< Time step
+      real *          out,       //!< Output values
+      mask *          saturated  //!< Saturation masks (null if not required)
+    )
+    {
+      static_assert(sizeof(real) == sizeof(double), "PIDBank AVX2 kernel requires double precision");
+      __m256d const v_dt   = _mm256_set1_pd(dt);
+      __m256d const v_half = _mm256_set1_pd(0.5);
+      __m256d const v_zero = _mm256_setzero_pd();
+      __m256d const v_one  = _mm256_set1_pd(1.0);
+      integer i = begin;
+      for (; i + 4 <= end; i += 4)
+      {
+        integer k = i - begin;
+        __m256d en = this->load_mask_avx2(LOOP, i);
+        __m256d ep = _mm256_and_pd(this->load_mask_avx2(PROPORTIONAL, i), en);
+        __m256d ei = _mm256_and_pd(this->load_mask_avx2(INTEGRAL, i), en);
+        __m256d ed = _mm256_and_pd(this->load_mask_avx2(DERIVATIVE, i), en);
+        __m256d ef = _mm256_and_pd(this->load_mask_avx2(FILTER, i), ed);
+        __m256d ea = this->load_mask_avx2(ANTIWINDUP, i);
+
+        __m256d e     = source != nullptr ? _mm256_set_pd(error[source[k + 3]], error[source[k + 2]], error[source[k + 1]], error[source[k]])
+                                          : _mm256_loadu_pd(error + k);
+        __m256d upper = _mm256_loadu_pd(this->m_upper.data() + i);
+        __m256d lower = _mm256_loadu_pd(this->m_lower.data() + i);
+
+        // Proportional
+        __m256d p = _mm256_and_pd(ep, _mm256_mul_pd(_mm256_loadu_pd(this->m_kp.data() + i), e));
+
+        // Conditional integration
+        __m256d u_old  = _mm256_loadu_pd(this->m_output.data() + i);
+        __m256d clamp  = _mm256_and_pd(ea, _mm256_or_pd(_mm256_cmp_pd(u_old, upper, _CMP_GT_OQ), _mm256_cmp_pd(u_old, lower, _CMP_LT_OQ)));
+        if (hold != nullptr)
+          clamp = _mm256_or_pd(clamp, this->load_mask_avx2(hold + k));
+        __m256d factor = _mm256_blendv_pd(v_one, v_zero, clamp);
+        __m256d e_int  = _mm256_mul_pd(factor, e);
+        __m256d integ  = _mm256_loadu_pd(this->m_integral.data() + i);
+        __m256d e_prev = _mm256_loadu_pd(this->m_error.data() + i);
+        integ = _mm256_blendv_pd(integ, _mm256_add_pd(integ, _mm256_mul_pd(_mm256_mul_pd(v_half, _mm256_add_pd(e_int, e_prev)), v_dt)), ei);
+        _mm256_storeu_pd(this->m_integral.data() + i, integ);
+        _mm256_storeu_pd(this->m_error.data() + i, _mm256_blendv_pd(e_prev, e_int, ei));
+        __m256d in = _mm256_and_pd(ei, _mm256_mul_pd(_mm256_loadu_pd(this->m_ki.data() + i), integ));
+
+        // Derivative
+        __m256d e_old = _mm256_loadu_pd(this->m_error_old.data() + i);
+        __m256d diff  = _mm256_div_pd(_mm256_sub_pd(e, e_old), v_dt);
+        __m256d y_old = _mm256_loadu_pd(this->m_filter_output.data() + i);
+        __m256d y     = _mm256_add_pd(y_old, _mm256_mul_pd(_mm256_sub_pd(diff, y_old), _mm256_loadu_pd(this->m_alpha.data() + i)));
+        _mm256_storeu_pd(this->m_filter_output.data() + i, _mm256_blendv_pd(y_old, y, ef));
+        diff = _mm256_blendv_pd(diff, y, ef);
+        _mm256_storeu_pd(this->m_error_old.data() + i, _mm256_blendv_pd(e_old, e, ed));
+        __m256d d = _mm256_and_pd(ed, _mm256_mul_pd(_mm256_loadu_pd(this->m_kd.data() + i), diff));
+
+        // Output saturation
+        __m256d u = _mm256_add_pd(_mm256_add_pd(p, in), d);
+        _mm256_storeu_pd(this->m_output.data() + i, _mm256_blendv_pd(u_old, u, en));
+        if (saturated != nullptr)
+        {
+          __m256d limit = _mm256_and_pd(_mm256_and_pd(en, ea), _mm256_or_pd(_mm256_cmp_pd(u, upper, _CMP_GT_OQ), _mm256_cmp_pd(u, lower, _CMP_LT_OQ)));
+          _mm256_storeu_si256(reinterpret_cast<__m256i *>(saturated + k), _mm256_castpd_si256(limit));
+        }
+        __m256d sat = _mm256_blendv_pd(u, lower, _mm256_cmp_pd(u, lower, _CMP_LT_OQ));
+        sat = _mm256_blendv_pd(sat, upper, _mm256_cmp_pd(u, upper, _CMP_GT_OQ));
+        u = _mm256_blendv_pd(u, sat, ea);
+        _mm256_storeu_pd(out + k, _mm256_and_pd(en, u));
+      }
+      return i;
+    }
+
+    //! Load four lane masks of a component as an AVX2 register
+    __m256d
+    load_mask_avx2(
+      Component c, //!< Lane component
+      integer   i  //!< First lane index
+    ) const
+    {
+      return this->load_mask_avx2(this->m_enabled[c].data() + i);
+    }
+
+    //! Load four lane masks as an AVX2 register
+    __m256d
+    load_mask_avx2(
+      mask const * masks //!< Lane masks
+    ) const
+    {
+      return _mm256_castsi256_pd(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(masks)));
+    }
+#endif
+
+#if defined(__SSE2__) && !defined(__AVX2__) && !defined(__AVX512F__)
+    //! SSE2 lanes kernel (the input and output arrays start at the first
+    //! lane), returns the index of the first unprocessed lane. SSE2 has no
+    //! blend instruction, so the masked choices are bitwise selections.
+    integer
+    setup_sse2(
+      integer         begin,     //!< First lane index
+      integer         end,       //!< End lane index
+      real const *    error,     //!< Input error values (or values the errors are gathered from)
+      integer const * source,    //!< Error value indices (null if the errors are in lane order)
+      mask const *    hold,      //!< Integrator hold masks (null if no lane is held)
+      real            dt,        //!< Time step
+      real *          out,       //!< Output values
+      mask *          saturated  //!< Saturation masks (null if not required)
+    )
+    {
+      static_assert(sizeof(real) == sizeof(double), "PIDBank SSE2 kernel requires double precision");
+      __m128d const v_dt   = _mm_set1_pd(dt);
+      __m128d const v_half = _mm_set1_pd(0.5);
+      __m128d const v_one  = _mm_set1_pd(1.0);
+      integer i = begin;
+      for (; i + 2 <= end; i += 2)
+      {
+        integer k = i - begin;
+        __m128d en = this->load_mask_sse2(LOOP, i);
+        __m128d ep = _mm_and_pd(this->load_mask_sse2(PROPORTIONAL, i), en);
+        __m128d ei = _mm_and_pd(this->load_mask_sse2(INTEGRAL, i), en);
+        __m128d ed = _mm_and_pd(this->load_mask_sse2(DERIVATIVE, i), en);
+        __m128d ef = _mm_and_pd(this->load_mask_sse2(FILTER, i), ed);
+        __m128d ea = this->load_mask_sse2(ANTIWINDUP, i);
+
+        __m128d e     = source != nullptr ? _mm_set_pd(error[source[k + 1]], error[source[k]]) : _mm_loadu_pd(error + k);
+        __m128d upper = _mm_loadu_pd(this->m_upper.data() + i);
+        __m128d lower = _mm_loadu_pd(this->m_lower.data() + i);
+
+        // Proportional
+        __m128d p = _mm_and_pd(ep, _mm_mul_pd(_mm_loadu_pd(this->m_kp.data() + i), e));
+
+        // Conditional integration
+        __m128d u_old  = _mm_loadu_pd(this->m_output.data() + i);
+        __m128d clamp  = _mm_and_pd(ea, _mm_or_pd(_mm_cmpgt_pd(u_old, upper), _mm_cmplt_pd(u_old, lower)));
+        if (hold != nullptr)
+          clamp = _mm_or_pd(clamp, this->load_mask_sse2(hold + k));
+        __m128d factor = _mm_andnot_pd(clamp, v_one);
+        __m128d e_int  = _mm_mul_pd(factor, e);
+        __m128d integ  = _mm_loadu_pd(this->m_integral.data() + i);
+        __m128d e_prev = _mm_loadu_pd(this->m_error.data() + i);
+        integ = this->select_sse2(ei, integ, _mm_add_pd(integ, _mm_mul_pd(_mm_mul_pd(v_half, _mm_add_pd(e_int, e_prev)), v_dt)));
+        _mm_storeu_pd(this->m_integral.data() + i, integ);
+        _mm_storeu_pd(this->m_error.data() + i, this->select_sse2(ei, e_prev, e_int));
+        __m128d in = _mm_and_pd(ei, _mm_mul_pd(_mm_loadu_pd(this->m_ki.data() + i), integ));
+
+        // Derivative
+        __m128d e_old = _mm_loadu_pd(this->m_error_old.data() + i);
+        __m128d diff  = _mm_div_pd(_mm_sub_pd(e, e_old), v_dt);
+        __m128d y_old = _mm_loadu_pd(this->m_filter_output.data() + i);
+        __m128d y     = _mm_add_pd(y_old, _mm_mul_pd(_mm_sub_pd(diff, y_old), _mm_loadu_pd(this->m_alpha.data() + i)));
+        _mm_storeu_pd(this->m_filter_output.data() + i, this->select_sse2(ef, y_old, y));
+        diff = this->select_sse2(ef, diff, y);
+        _mm_storeu_pd(this->m_error_old.data() + i, this->select_sse2(ed, e_old, e));
+        __m128d d = _mm_and_pd(ed, _mm_mul_pd(_mm_loadu_pd(this->m_kd.data() + i), diff));
+
+        // Output saturation
+        __m128d u = _mm_add_pd(_mm_add_pd(p, in), d);
+        _mm_storeu_pd(this->m_output.data() + i, this->select_sse2(en, u_old, u));
+        if (saturated != nullptr)
+        {
+          __m128d limit = _mm_and_pd(_mm_and_pd(en, ea), _mm_or_pd(_mm_cmpgt_pd(u, upper), _mm_cmplt_pd(u, lower)));
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(saturated + k), _mm_castpd_si128(limit));
+        }
+        __m128d sat = this->select_sse2(_mm_cmplt_pd(u, lower), u, lower);
+        sat = this->select_sse2(_mm_cmpgt_pd(u, upper), sat, upper);
+        u = this->select_sse2(ea, u, sat);
+        _mm_storeu_pd(out + k, _mm_and_pd(en, u));
+      }
+      return i;
+    }
+
+    //! Load two lane masks of a component as an SSE2 register
+    __m128d
+    load_mask_sse2(
+      Component c, //!< Lane component
+      integer   i  //!< First lane index
+    ) const
+    {
+      return this->load_mask_sse2(this->m_enabled[c].data() + i);
+    }
+
+    //! Load two lane masks as an SSE2 register
+    __m128d
+    load_mask_sse2(
+      mask const * masks //!< Lane masks
+    ) const
+    {
+      return _mm_castsi128_pd(_mm_loadu_si128(reinterpret_cast<__m128i const *>(masks)));
+    }
+
+    //! Select the lanes of the second value where the mask is set, and of the
+    //! first value elsewhere
+    static __m128d
+    select_sse2(
+      __m128d m, //!< Lane masks
+      __m128d a, //!< Values of the unset lanes
+      __m128d b  //!< Values of the set lanes
+    )
+    {
+      return _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a));
+    }
+#endif
+
+  }; // class PIDBank
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: PidBank.hh
+///
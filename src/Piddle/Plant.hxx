@@ -0,0 +1,633 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Plant.hh
+///
+
+#ifndef INCLUDE_PIDDLE_PLANT
+#define INCLUDE_PIDDLE_PLANT
+
+#include "Block.hxx"
+
+#include <vector>
+
+namespace Piddle
+{
+
+  /*\
+   |   ____  _             _
+   |  |  _ \| | __ _ _ __ | |_
+   |  | |_) | |/ _` | '_ \| __|
+   |  |  __/| | (_| | | | | |_
+   |  |_|   |_|\__,_|_| |_|\__|
+   |
+  \*/
+
+  //! Class to represent a pure transport delay. The delay line is resized
+  //! only when the time step or the dead time change (or through prepare), so
+  //! that a fixed time step simulation does not allocate after its first step.
+  class DeadTime : public Block
+  {
+  private:
+    real              m_delay;                 //!< Dead time (s)
+    std::vector<real> m_line;                  //!< Delay line
+    std::size_t       m_head   = 0;            //!< Delay line oldest sample index
+    real              m_dt     = real(0.0);    //!< Time step of the delay line
+    real              m_length = real(0.0);    //!< Dead time of the delay line
+    bool              m_cached = false;        //!< Delay line validity flag
+
+  public:
+    //! Class constructor
+    DeadTime(
+      real delay = real(0.0) //!< Dead time (s)
+    )
+      : m_delay(delay)
+    {
+      PIDDLE_ASSERT(!(delay < real(0.0)),
+        "Piddle::DeadTime::DeadTime(...): negative dead time " << delay << ".");
+    }
+
+    //! Get dead time const reference
+    real const &
+    delay(void) const
+    {
+      return this->m_delay;
+    }
+
+    //! Get dead time reference
+    real &
+    delay(void)
+    {
+      return this->m_delay;
+    }
+
+    //! Get the delay line length (samples)
+    std::size_t
+    samples(void) const
+    {
+      return this->m_line.size();
+    }
+
+    //! Size the delay line for a time step (the dead time is rounded to the
+    //! nearest multiple of the time step) and clear it
+    void
+    prepare(
+      real dt //!< Time step
+    )
+    {
+      PIDDLE_ASSERT(dt > real(0.0),
+        "Piddle::DeadTime::prepare(...): non-positive time step " << dt << ".");
+      this->m_line.assign(std::size_t(std::lround(this->m_delay / dt)), real(0.0));
+      this->m_head   = 0;
+      this->m_dt     = dt;
+      this->m_length = this->m_delay;
+      this->m_cached = true;
+    }
+
+    //! Setup dead time block
+    real
+    setup(
+      real input, //!< Input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      if (!this->m_cached || !(dt == this->m_dt) || !(this->m_delay == this->m_length))
+        this->prepare(dt);
+      if (this->m_line.empty())
+        return input;
+      real output = this->m_line[this->m_head];
+      this->m_line[this->m_head] = input;
+      if (++this->m_head == this->m_line.size())
+        this->m_head = 0;
+      return output;
+    }
+
+    //! Save dead time state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_DEAD_TIME);
+      writer.write(this->m_delay);
+      writer.write(this->m_dt);
+      writer.write(std::uint8_t(this->m_cached ? 1 : 0));
+      writer.write(std::uint64_t(this->m_line.size()));
+      writer.write(std::span<real const>(this->m_line));
+      writer.write(std::uint64_t(this->m_head));
+    }
+
+    //! Restore dead time state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_DEAD_TIME);
+      real          delay  = reader.read<real>();
+      real          dt     = reader.read<real>();
+      bool          cached = reader.read<std::uint8_t>() != 0;
+      std::uint64_t length = reader.read<std::uint64_t>();
+      PIDDLE_ASSERT(length <= reader.remaining() / sizeof(real),
+        "Piddle::DeadTime::restore(...): delay line length " << length << " exceeds the snapshot size.");
+      std::vector<real> line(std::size_t(length), real(0.0));
+      reader.read(std::span<real>(line));
+      std::uint64_t head = reader.read<std::uint64_t>();
+      PIDDLE_ASSERT(head < length || (head == 0 && length == 0),
+        "Piddle::DeadTime::restore(...): delay line head " << head << " out of range for length " << length << ".");
+      this->m_delay  = delay;
+      this->m_dt     = dt;
+      this->m_cached = cached;
+      this->m_line   = std::move(line);
+      this->m_head   = std::size_t(head);
+      this->m_length = this->m_delay;
+    }
+
+    //! Reset dead time block (the delay line keeps its length)
+    void
+    reset(void) override
+    {
+      std::fill(this->m_line.begin(), this->m_line.end(), real(0.0));
+      this->m_head = 0;
+    }
+
+    //! Get a copy of the dead time block (with its own delay line)
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<DeadTime>(*this);
+    }
+
+  }; // class DeadTime
+
+  //! Class to represent a first order plus dead time plant
+  //! K/(T*s + 1)*exp(-L*s), discretised exactly under a zero-order hold.
+  class FirstOrderPlant : public Block
+  {
+  private:
+    DeadTime m_dead_time;                 //!< Input dead time
+    real     m_gain;                      //!< Static gain
+    real     m_time_constant;             //!< Time constant (s)
+    real     m_output = real(0.0);        //!< Plant output
+    real     m_beta   = real(0.0);        //!< Cached discretised coefficient
+    real     m_dt     = real(0.0);        //!< Time step of the cached coefficient
+    real     m_tau    = real(0.0);        //!< Time constant of the cached coefficient
+    bool     m_cached = false;            //!< Cached coefficient validity flag
+
+  public:
+    //! Class constructor
+    FirstOrderPlant(
+      real gain          = real(1.0), //!< Static gain
+      real time_constant = real(1.0), //!< Time constant (s)
+      real dead_time     = real(0.0)  //!< Dead time (s)
+    )
+      : m_dead_time(dead_time), m_gain(gain), m_time_constant(time_constant)
+    {
+      PIDDLE_ASSERT(time_constant > real(0.0),
+        "Piddle::FirstOrderPlant::FirstOrderPlant(...): non-positive time constant " << time_constant << ".");
+    }
+
+    //! Get static gain const reference
+    real const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get static gain reference
+    real &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Get time constant const reference
+    real const &
+    time_constant(void) const
+    {
+      return this->m_time_constant;
+    }
+
+    //! Get time constant reference
+    real &
+    time_constant(void)
+    {
+      return this->m_time_constant;
+    }
+
+    //! Get dead time block const reference
+    DeadTime const &
+    dead_time(void) const
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get dead time block reference
+    DeadTime &
+    dead_time(void)
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get plant output const reference
+    real const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Preallocate the plant for a time step
+    void
+    prepare(
+      real dt //!< Time step
+    )
+    {
+      this->m_dead_time.prepare(dt);
+      this->discretise(dt);
+    }
+
+    //! Setup plant (advance by one time step and return the new output)
+    real
+    setup(
+      real input, //!< Plant input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      if (!this->m_cached || !(dt == this->m_dt) || !(this->m_time_constant == this->m_tau))
+        this->discretise(dt);
+      real delayed = this->m_dead_time.setup(input, dt);
+      return this->m_output += (this->m_gain * delayed - this->m_output) * this->m_beta;
+    }
+
+    //! Save plant state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_FIRST_ORDER_PLANT);
+      writer.write(this->m_gain);
+      writer.write(this->m_time_constant);
+      writer.write(this->m_output);
+      this->m_dead_time.save(writer);
+    }
+
+    //! Restore plant state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_FIRST_ORDER_PLANT);
+      reader.read(this->m_gain);
+      reader.read(this->m_time_constant);
+      reader.read(this->m_output);
+      this->m_dead_time.restore(reader);
+    }
+
+    //! Reset plant
+    void
+    reset(void) override
+    {
+      this->m_dead_time.reset();
+      this->m_output = real(0.0);
+    }
+
+    //! Get a copy of the plant
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<FirstOrderPlant>(*this);
+    }
+
+  private:
+    //! Compute the discretised coefficient
+    void
+    discretise(
+      real dt //!< Time step
+    )
+    {
+      this->m_beta   = real(1.0) - std::exp(-dt / this->m_time_constant);
+      this->m_dt     = dt;
+      this->m_tau    = this->m_time_constant;
+      this->m_cached = true;
+    }
+
+  }; // class FirstOrderPlant
+
+  //! Class to represent a second order plus dead time plant
+  //! K*wn^2/(s^2 + 2*zeta*wn*s + wn^2)*exp(-L*s), integrated with the
+  //! semi-implicit Euler method (stable for wn*dt < 2).
+  class SecondOrderPlant : public Block
+  {
+  private:
+    DeadTime m_dead_time;              //!< Input dead time
+    real     m_gain;                   //!< Static gain
+    real     m_frequency;              //!< Natural frequency (rad/s)
+    real     m_damping;                //!< Damping ratio
+    real     m_output = real(0.0);     //!< Plant output
+    real     m_rate   = real(0.0);     //!< Plant output rate
+
+  public:
+    //! Class constructor
+    SecondOrderPlant(
+      real gain      = real(1.0), //!< Static gain
+      real frequency = real(1.0), //!< Natural frequency (rad/s)
+      real damping   = real(1.0), //!< Damping ratio
+      real dead_time = real(0.0)  //!< Dead time (s)
+    )
+      : m_dead_time(dead_time), m_gain(gain), m_frequency(frequency), m_damping(damping)
+    {
+      PIDDLE_ASSERT(frequency > real(0.0),
+        "Piddle::SecondOrderPlant::SecondOrderPlant(...): non-positive natural frequency " << frequency << ".");
+    }
+
+    //! Get static gain const reference
+    real const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get static gain reference
+    real &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Get natural frequency const reference
+    real const &
+    frequency(void) const
+    {
+      return this->m_frequency;
+    }
+
+    //! Get natural frequency reference
+    real &
+    frequency(void)
+    {
+      return this->m_frequency;
+    }
+
+    //! Get damping ratio const reference
+    real const &
+    damping(void) const
+    {
+      return this->m_damping;
+    }
+
+    //! Get damping ratio reference
+    real &
+    damping(void)
+    {
+      return this->m_damping;
+    }
+
+    //! Get dead time block const reference
+    DeadTime const &
+    dead_time(void) const
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get dead time block reference
+    DeadTime &
+    dead_time(void)
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get plant output const reference
+    real const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Preallocate the plant for a time step
+    void
+    prepare(
+      real dt //!< Time step
+    )
+    {
+      this->m_dead_time.prepare(dt);
+    }
+
+    //! Setup plant (advance by one time step and return the new output)
+    real
+    setup(
+      real input, //!< Plant input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      real delayed = this->m_dead_time.setup(input, dt);
+      real wn2     = this->m_frequency * this->m_frequency;
+      real accel   = wn2 * (this->m_gain * delayed - this->m_output) -
+                     real(2.0) * this->m_damping * this->m_frequency * this->m_rate;
+      this->m_rate   += accel * dt;
+      this->m_output += this->m_rate * dt;
+      return this->m_output;
+    }
+
+    //! Save plant state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_SECOND_ORDER_PLANT);
+      writer.write(this->m_gain);
+      writer.write(this->m_frequency);
+      writer.write(this->m_damping);
+      writer.write(this->m_output);
+      writer.write(this->m_rate);
+      this->m_dead_time.save(writer);
+    }
+
+    //! Restore plant state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_SECOND_ORDER_PLANT);
+      reader.read(this->m_gain);
+      reader.read(this->m_frequency);
+      reader.read(this->m_damping);
+      reader.read(this->m_output);
+      reader.read(this->m_rate);
+      this->m_dead_time.restore(reader);
+    }
+
+    //! Reset plant
+    void
+    reset(void) override
+    {
+      this->m_dead_time.reset();
+      this->m_output = real(0.0);
+      this->m_rate   = real(0.0);
+    }
+
+    //! Get a copy of the plant
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<SecondOrderPlant>(*this);
+    }
+
+  }; // class SecondOrderPlant
+
+  //! Class to represent an integrating plus dead time plant K/s*exp(-L*s)
+  class IntegratingPlant : public Block
+  {
+  private:
+    DeadTime m_dead_time;          //!< Input dead time
+    real     m_gain;               //!< Integration gain
+    real     m_output = real(0.0); //!< Plant output
+
+  public:
+    //! Class constructor
+    IntegratingPlant(
+      real gain      = real(1.0), //!< Integration gain
+      real dead_time = real(0.0)  //!< Dead time (s)
+    )
+      : m_dead_time(dead_time), m_gain(gain)
+    {
+    }
+
+    //! Get integration gain const reference
+    real const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get integration gain reference
+    real &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Get dead time block const reference
+    DeadTime const &
+    dead_time(void) const
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get dead time block reference
+    DeadTime &
+    dead_time(void)
+    {
+      return this->m_dead_time;
+    }
+
+    //! Get plant output const reference
+    real const &
+    output(void) const
+    {
+      return this->m_output;
+    }
+
+    //! Preallocate the plant for a time step
+    void
+    prepare(
+      real dt //!< Time step
+    )
+    {
+      this->m_dead_time.prepare(dt);
+    }
+
+    //! Setup plant (advance by one time step and return the new output)
+    real
+    setup(
+      real input, //!< Plant input value
+      real dt     //!< Time step
+    )
+    override
+    {
+      real delayed = this->m_dead_time.setup(input, dt);
+      return this->m_output += this->m_gain * delayed * dt;
+    }
+
+    //! Save plant state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_INTEGRATING_PLANT);
+      writer.write(this->m_gain);
+      writer.write(this->m_output);
+      this->m_dead_time.save(writer);
+    }
+
+    //! Restore plant state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_INTEGRATING_PLANT);
+      reader.read(this->m_gain);
+      reader.read(this->m_output);
+      this->m_dead_time.restore(reader);
+    }
+
+    //! Reset plant
+    void
+    reset(void) override
+    {
+      this->m_dead_time.reset();
+      this->m_output = real(0.0);
+    }
+
+    //! Get a copy of the plant
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<IntegratingPlant>(*this);
+    }
+
+  }; // class IntegratingPlant
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Plant.hh
+///
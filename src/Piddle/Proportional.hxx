@@ -41,18 +41,132 @@ namespace Piddle
    |  |_|             |_|
   \*/
 
+  //! Class to represent a static proportional component
+  template <typename Scalar>
+  class BasicProportional
+  {
+  private:
+    Scalar m_gain; //!< Proportional gain coefficient
+
+  public:
+    static constexpr bool ENABLED = true; //!< Component presence flag
+
+    //! Class constructor
+    BasicProportional(
+      Scalar gain = Scalar(1.0) //!< Proportional gain coefficient
+    )
+      : m_gain(gain)
+    {
+    }
+
+    //! Get proportional gain const reference
+    Scalar const &
+    gain(void) const
+    {
+      return this->m_gain;
+    }
+
+    //! Get proportional gain reference
+    Scalar &
+    gain(void)
+    {
+      return this->m_gain;
+    }
+
+    //! Setup proportional component
+    Scalar
+    setup(
+      Scalar error, //!< Input source value
+      Scalar        //!< Time step value
+    )
+    const
+    {
+      return this->m_gain * error;
+    }
+
+    //! Setup proportional component over a batch of samples (stateless,
+    //! vectorisable loop)
+    void
+    process(
+      std::span<Scalar const> error, //!< Input source values
+      std::span<Scalar const> dt,    //!< Time step values (one fixed or one per sample)
+      std::span<Scalar>       out    //!< Output values
+    )
+    const
+    {
+      check_batch(error, dt, out, "BasicProportional::process");
+      Scalar const   gain   = this->m_gain;
+      Scalar const * input  = error.data();
+      Scalar *       output = out.data();
+      for (std::size_t k = 0; k < error.size(); ++k)
+        output[k] = gain * input[k];
+    }
+
+    //! Save proportional component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const
+    {
+      writer.write(this->m_gain);
+    }
+
+    //! Restore proportional component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    {
+      reader.read(this->m_gain);
+    }
+
+    //! Reset proportional component
+    void
+    reset(void)
+    {
+    }
+
+  }; // class BasicProportional
+
+  //! Class to represent a removed static proportional component
+  template <typename Scalar>
+  class NoProportional
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Component presence flag
+
+    //! Setup proportional component
+    Scalar
+    setup(
+      Scalar, //!< Input source value
+      Scalar  //!< Time step value
+    )
+    const
+    {
+      return Scalar(0.0);
+    }
+
+    //! Reset proportional component
+    void
+    reset(void)
+    {
+    }
+
+  }; // class NoProportional
+
   //! Class to represent proportional component
   class Proportional : public Block
   {
   private:
-    real m_gain; //!< Proportional gain coefficient
+    BasicProportional<real> m_core; //!< Static proportional component
 
   public:
     //! Class constructor
     Proportional(
       real gain = real(1.0) //!< Proportional gain coefficient
     )
-      : m_gain(gain)
+      : m_core(gain)
     {
     }
 
@@ -60,34 +174,82 @@ namespace Piddle
     real const &
     gain(void) const
     {
-      return this->m_gain;
+      return this->m_core.gain();
     }
 
     //! Get proportional gain reference
     real &
     gain(void)
     {
-      return this->m_gain;
+      return this->m_core.gain();
     }
 
     //! Setup proportional component
     real
     setup(
       real error, //!< Input source value
-      real step   //!< Time step value
+      real dt     //!< Time step value
     )
-    const override
+    override
     {
       if (this->is_enabled())
-        return this->m_gain * error;
+        return this->m_core.setup(error, dt);
       else
         return real(0.0);
     }
 
+    //! Setup proportional component over a batch of samples
+    void
+    process(
+      std::span<real const> error, //!< Input source values
+      std::span<real const> dt,    //!< Time step values (one fixed or one per sample)
+      std::span<real>       out    //!< Output values
+    )
+    override
+    {
+      if (this->is_enabled())
+        this->m_core.process(error, dt, out);
+      else
+      {
+        check_batch(error, dt, out, "Proportional::process");
+        std::fill(out.begin(), out.end(), real(0.0));
+      }
+    }
+
+    //! Save proportional component state and parameters
+    void
+    save(
+      StateWriter & writer //!< State writer
+    )
+    const override
+    {
+      this->save_header(writer, STATE_PROPORTIONAL);
+      this->m_core.save(writer);
+    }
+
+    //! Restore proportional component state and parameters
+    void
+    restore(
+      StateReader & reader //!< State reader
+    )
+    override
+    {
+      this->restore_header(reader, STATE_PROPORTIONAL);
+      this->m_core.restore(reader);
+    }
+
     //! Reset proportional component
-    real
+    void
     reset(void) override
     {
+      this->m_core.reset();
+    }
+
+    //! Get a copy of the proportional component
+    std::shared_ptr<Block>
+    clone(void) const override
+    {
+      return std::make_shared<Proportional>(*this);
     }
 
   }; // class Proportional
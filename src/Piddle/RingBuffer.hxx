@@ -0,0 +1,136 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: RingBuffer.hh
+///
+
+#ifndef INCLUDE_PIDDLE_RINGBUFFER
+#define INCLUDE_PIDDLE_RINGBUFFER
+
+#include <atomic>
+#include <cstddef>
+
+namespace Piddle
+{
+
+  /*\
+   |   ____  _             ____         __  __
+   |  |  _ \(_)_ __   __ _| __ ) _   _ / _|/ _| ___ _ __
+   |  | |_) | | '_ \ / _` |  _ \| | | | |_| |_ / _ \ '__|
+   |  |  _ <| | | | | (_| | |_) | |_| |  _|  _|  __/ |
+   |  |_| \_\_|_| |_|\__, |____/ \__,_|_| |_|  \___|_|
+   |                 |___/
+  \*/
+
+  //! Class to represent a lock-free single-producer single-consumer ring
+  //! buffer with a power-of-two capacity. Storage is allocated once at
+  //! construction; push and pop never block nor allocate. Each side keeps a
+  //! cached copy of the other side index, so that the shared indices are
+  //! only read when the cached ones say the buffer is full or empty.
+  template <typename T, std::size_t CAPACITY>
+  class RingBuffer
+  {
+    static_assert(CAPACITY > 1 && (CAPACITY & (CAPACITY - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+  private:
+    static constexpr std::size_t MASK = CAPACITY - 1; //!< Index mask
+
+    std::unique_ptr<T[]> m_data; //!< Buffer storage
+
+    alignas(64) std::atomic<std::size_t> m_head{0};      //!< Consumer index
+    std::size_t                          m_tail_cache = 0; //!< Consumer cached producer index
+    alignas(64) std::atomic<std::size_t> m_tail{0};      //!< Producer index
+    std::size_t                          m_head_cache = 0; //!< Producer cached consumer index
+
+  public:
+    //! Class constructor
+    RingBuffer(void)
+      : m_data(new T[CAPACITY])
+    {
+    }
+
+    //! Deleted copy constructor
+    RingBuffer(RingBuffer const &) = delete;
+
+    //! Deleted copy assignment operator
+    RingBuffer & operator=(RingBuffer const &) = delete;
+
+    //! Get buffer capacity
+    static constexpr std::size_t
+    capacity(void)
+    {
+      return CAPACITY;
+    }
+
+    //! Get an estimate of the number of stored elements
+    std::size_t
+    size(void) const
+    {
+      return this->m_tail.load(std::memory_order_acquire) - this->m_head.load(std::memory_order_acquire);
+    }
+
+    //! Push an element (producer thread only), returns false if the buffer is full
+    bool
+    push(
+      T const & value //!< Element to be pushed
+    )
+    {
+      std::size_t tail = this->m_tail.load(std::memory_order_relaxed);
+      if (tail - this->m_head_cache == CAPACITY)
+      {
+        this->m_head_cache = this->m_head.load(std::memory_order_acquire);
+        if (tail - this->m_head_cache == CAPACITY)
+          return false;
+      }
+      this->m_data[tail & MASK] = value;
+      this->m_tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    //! Pop an element (consumer thread only), returns false if the buffer is empty
+    bool
+    pop(
+      T & value //!< Popped element
+    )
+    {
+      std::size_t head = this->m_head.load(std::memory_order_relaxed);
+      if (head == this->m_tail_cache)
+      {
+        this->m_tail_cache = this->m_tail.load(std::memory_order_acquire);
+        if (head == this->m_tail_cache)
+          return false;
+      }
+      value = this->m_data[head & MASK];
+      this->m_head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+  }; // class RingBuffer
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: RingBuffer.hh
+///
@@ -0,0 +1,330 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: State.hh
+///
+
+#ifndef INCLUDE_PIDDLE_STATE
+#define INCLUDE_PIDDLE_STATE
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Piddle
+{
+
+  /*\
+   |   ____  _         _
+   |  / ___|| |_  __ _| |_  ___
+   |  \___ \| __|/ _` | __|/ _ \
+   |   ___) | |_| (_| | |_|  __/
+   |  |____/ \__|\__,_|\__|\___|
+   |
+  \*/
+
+  //! State snapshot format version (snapshots of newer versions are rejected)
+  static constexpr std::uint16_t STATE_VERSION = 1;
+
+  //! State snapshot magic number ("PDLS" in little endian byte order)
+  static constexpr std::uint32_t STATE_MAGIC = 0x534C4450u;
+
+  //! Tags of the block state records, so that a snapshot cannot be restored
+  //! into a different block layout unnoticed
+  enum StateTag : std::uint8_t
+  {
+    STATE_BLOCK              = 0,  //!< Generic block (enabling state only)
+    STATE_PROPORTIONAL       = 1,  //!< Proportional component
+    STATE_INTEGRAL           = 2,  //!< Integral component
+    STATE_DERIVATIVE         = 3,  //!< Derivative component
+    STATE_FILTER             = 4,  //!< First order low-pass filter
+    STATE_ANTIWINDUP         = 5,  //!< Anti-windup component
+    STATE_PID                = 6,  //!< Pid loop
+    STATE_BUTTERWORTH        = 7,  //!< Butterworth low-pass filter
+    STATE_MOVING_AVERAGE     = 8,  //!< Moving average filter
+    STATE_DEAD_TIME          = 9,  //!< Dead time
+    STATE_FIRST_ORDER_PLANT  = 10, //!< First order plus dead time plant
+    STATE_SECOND_ORDER_PLANT = 11, //!< Second order plus dead time plant
+    STATE_INTEGRATING_PLANT  = 12, //!< Integrating plus dead time plant
+    STATE_PID_BANK           = 13, //!< Pid bank
+    STATE_GRAPH              = 14  //!< Controller graph
+  };
+
+  //! Compute the 64-bit XXH64 checksum of a byte sequence (words are read in
+  //! the native byte order, so checksums are portable only across machines
+  //! with the same endianness)
+  inline
+  std::uint64_t
+  state_checksum(
+    std::span<std::uint8_t const> data, //!< Input bytes
+    std::uint64_t                 seed = 0 //!< Checksum seed
+  )
+  {
+    constexpr std::uint64_t P1 = 0x9E3779B185EBCA87ull;
+    constexpr std::uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr std::uint64_t P3 = 0x165667B19E3779F9ull;
+    constexpr std::uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+    constexpr std::uint64_t P5 = 0x27D4EB2F165667C5ull;
+    auto rotl  = [](std::uint64_t x, int r) {return (x << r) | (x >> (64 - r));};
+    auto round = [rotl](std::uint64_t acc, std::uint64_t lane) {return rotl(acc + lane * P2, 31) * P1;};
+    auto merge = [round](std::uint64_t acc, std::uint64_t lane) {return (acc ^ round(0, lane)) * P1 + P4;};
+    auto load8 = [](std::uint8_t const * p) {std::uint64_t v; std::memcpy(&v, p, 8); return v;};
+    auto load4 = [](std::uint8_t const * p) {std::uint32_t v; std::memcpy(&v, p, 4); return std::uint64_t(v);};
+
+    std::uint8_t const * p   = data.data();
+    std::uint8_t const * end = p + data.size();
+    std::uint64_t        h;
+    if (data.size() >= 32)
+    {
+      std::uint64_t v1 = seed + P1 + P2;
+      std::uint64_t v2 = seed + P2;
+      std::uint64_t v3 = seed;
+      std::uint64_t v4 = seed - P1;
+      for (; p + 32 <= end; p += 32)
+      {
+        v1 = round(v1, load8(p));
+        v2 = round(v2, load8(p + 8));
+        v3 = round(v3, load8(p + 16));
+        v4 = round(v4, load8(p + 24));
+      }
+      h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+      h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    }
+    else
+    {
+      h = seed + P5;
+    }
+    h += std::uint64_t(data.size());
+    for (; p + 8 <= end; p += 8)
+      h = rotl(h ^ round(0, load8(p)), 27) * P1 + P4;
+    if (p + 4 <= end)
+    {
+      h = rotl(h ^ (load4(p) * P1), 23) * P2 + P3;
+      p += 4;
+    }
+    for (; p < end; ++p)
+      h = rotl(h ^ (std::uint64_t(*p) * P5), 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  //! Class to represent a compact binary state snapshot writer. Values are
+  //! stored as raw native bytes without padding, and the buffer only grows,
+  //! so that rewriting a snapshot of the same blocks does not allocate.
+  class StateWriter
+  {
+  private:
+    std::vector<std::uint8_t> m_buffer;   //!< Snapshot buffer
+    std::size_t               m_size = 0; //!< Snapshot size (bytes)
+
+  public:
+    //! Class constructor
+    StateWriter(
+      std::size_t capacity = 0 //!< Initial buffer capacity (bytes)
+    )
+      : m_buffer(capacity)
+    {
+    }
+
+    //! Get snapshot bytes
+    std::span<std::uint8_t const>
+    data(void) const
+    {
+      return std::span<std::uint8_t const>(this->m_buffer.data(), this->m_size);
+    }
+
+    //! Get snapshot size (bytes)
+    std::size_t
+    size(void) const
+    {
+      return this->m_size;
+    }
+
+    //! Clear the snapshot (the buffer capacity is kept)
+    void
+    clear(void)
+    {
+      this->m_size = 0;
+    }
+
+    //! Write the snapshot header
+    void
+    header(
+      std::uint32_t records //!< Number of top-level records
+    )
+    {
+      this->write(STATE_MAGIC);
+      this->write(STATE_VERSION);
+      this->write(std::uint16_t(0));
+      this->write(records);
+    }
+
+    //! Write a trivially copyable value
+    template <typename Type>
+    void
+    write(
+      Type const & value //!< Value
+    )
+    {
+      static_assert(std::is_trivially_copyable<Type>::value, "state values must be trivially copyable");
+      std::memcpy(this->reserve(sizeof(Type)), &value, sizeof(Type));
+    }
+
+    //! Write an array of trivially copyable values
+    template <typename Type>
+    void
+    write(
+      std::span<Type const> values //!< Values
+    )
+    {
+      static_assert(std::is_trivially_copyable<Type>::value, "state values must be trivially copyable");
+      if (!values.empty())
+        std::memcpy(this->reserve(values.size_bytes()), values.data(), values.size_bytes());
+    }
+
+  private:
+    //! Reserve bytes at the end of the snapshot and get their address
+    std::uint8_t *
+    reserve(
+      std::size_t bytes //!< Number of bytes
+    )
+    {
+      if (this->m_size + bytes > this->m_buffer.size())
+        this->m_buffer.resize(std::max(2 * this->m_buffer.size(), this->m_size + bytes));
+      std::uint8_t * address = this->m_buffer.data() + this->m_size;
+      this->m_size += bytes;
+      return address;
+    }
+
+  }; // class StateWriter
+
+  //! Class to represent a binary state snapshot reader
+  class StateReader
+  {
+  private:
+    std::span<std::uint8_t const> m_data;       //!< Snapshot bytes
+    std::size_t                   m_offset = 0; //!< Read offset (bytes)
+
+  public:
+    //! Class constructor
+    StateReader(
+      std::span<std::uint8_t const> data //!< Snapshot bytes
+    )
+      : m_data(data)
+    {
+    }
+
+    //! Get the number of unread bytes
+    std::size_t
+    remaining(void) const
+    {
+      return this->m_data.size() - this->m_offset;
+    }
+
+    //! Read and check the snapshot header, and get the number of top-level records
+    std::uint32_t
+    header(void)
+    {
+      std::uint32_t magic   = this->read<std::uint32_t>();
+      std::uint16_t version = this->read<std::uint16_t>();
+      this->read<std::uint16_t>();
+      PIDDLE_ASSERT(magic == STATE_MAGIC,
+        "Piddle::StateReader::header(...): not a state snapshot.");
+      PIDDLE_ASSERT(version <= STATE_VERSION,
+        "Piddle::StateReader::header(...): unsupported snapshot version " << version << ".");
+      return this->read<std::uint32_t>();
+    }
+
+    //! Read a trivially copyable value
+    template <typename Type>
+    Type
+    read(void)
+    {
+      Type value;
+      this->read(value);
+      return value;
+    }
+
+    //! Read a trivially copyable value
+    template <typename Type>
+    void
+    read(
+      Type & value //!< Value
+    )
+    {
+      static_assert(std::is_trivially_copyable<Type>::value, "state values must be trivially copyable");
+      std::memcpy(&value, this->consume(sizeof(Type)), sizeof(Type));
+    }
+
+    //! Read an array of trivially copyable values
+    template <typename Type>
+    void
+    read(
+      std::span<Type> values //!< Values
+    )
+    {
+      static_assert(std::is_trivially_copyable<Type>::value, "state values must be trivially copyable");
+      if (!values.empty())
+        std::memcpy(values.data(), this->consume(values.size_bytes()), values.size_bytes());
+    }
+
+    //! Read a record tag and check it
+    void
+    expect(
+      StateTag tag //!< Expected record tag
+    )
+    {
+      std::uint8_t found = this->read<std::uint8_t>();
+      PIDDLE_ASSERT(found == tag,
+        "Piddle::StateReader::expect(...): found record " << integer(found) << " instead of " << integer(tag) << ".");
+    }
+
+  private:
+    //! Consume bytes of the snapshot and get their address
+    std::uint8_t const *
+    consume(
+      std::size_t bytes //!< Number of bytes
+    )
+    {
+      PIDDLE_ASSERT(bytes <= this->remaining(),
+        "Piddle::StateReader::read(...): truncated snapshot.");
+      std::uint8_t const * address = this->m_data.data() + this->m_offset;
+      this->m_offset += bytes;
+      return address;
+    }
+
+  }; // class StateReader
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: State.hh
+///
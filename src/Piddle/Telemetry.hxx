@@ -0,0 +1,457 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Telemetry.hh
+///
+
+#ifndef INCLUDE_PIDDLE_TELEMETRY
+#define INCLUDE_PIDDLE_TELEMETRY
+
+#include "RingBuffer.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Per-record capacity of the telemetry channels
+#ifndef PIDDLE_TELEMETRY_CAPACITY
+#define PIDDLE_TELEMETRY_CAPACITY 4096
+#endif
+
+namespace Piddle
+{
+
+  /*\
+   |   _____     _                     _
+   |  |_   _|___| | ___ _ __ ___   ___| |_ _ __ _   _
+   |    | | / _ \ |/ _ \ '_ ` _ \ / _ \ __| '__| | | |
+   |    | ||  __/ |  __/ | | | | |  __/ |_| |  | |_| |
+   |    |_| \___|_|\___|_| |_| |_|\___|\__|_|   \__, |
+   |                                            |___/
+  \*/
+
+  //! Get the telemetry clock ticks (time-stamp counter on x86, steady clock
+  //! nanoseconds otherwise)
+  inline std::uint64_t
+  telemetry_ticks(void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  //! Estimate the telemetry clock frequency (ticks per second)
+  inline double
+  telemetry_ticks_per_second(void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    auto          time_0 = std::chrono::steady_clock::now();
+    std::uint64_t tick_0 = telemetry_ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto          time_1 = std::chrono::steady_clock::now();
+    std::uint64_t tick_1 = telemetry_ticks();
+    return double(tick_1 - tick_0) / std::chrono::duration<double>(time_1 - time_0).count();
+#else
+    return 1.0e9;
+#endif
+  }
+
+  //! Structure to represent a single pid step record (fixed binary layout)
+  struct PIDRecord
+  {
+    static constexpr std::uint32_t UPPER_CLAMP = 0x1; //!< Output clamped to the upper bound flag
+    static constexpr std::uint32_t LOWER_CLAMP = 0x2; //!< Output clamped to the lower bound flag
+    static constexpr std::uint32_t FROZEN      = 0x4; //!< Integration frozen by the anti-windup flag
+
+    std::uint64_t timestamp;    //!< Telemetry clock ticks
+    std::uint32_t id;           //!< Controller identifier
+    std::uint32_t flags;        //!< Clamp state flags
+    double        error;        //!< Input error value
+    double        proportional; //!< Proportional term
+    double        integral;     //!< Integral term
+    double        derivative;   //!< Derivative (filtered) term
+    double        unsaturated;  //!< Output before saturation
+    double        output;       //!< Output after saturation
+  };
+
+  static_assert(sizeof(PIDRecord) == 64, "PIDRecord binary layout must be 64 bytes");
+
+  //! Get the clamp state flags of a pid step
+  template <typename Scalar>
+  std::uint32_t
+  telemetry_flags(
+    Scalar unsaturated, //!< Output before saturation
+    Scalar output,      //!< Output after saturation
+    Scalar integration  //!< Conditional integration factor
+  )
+  {
+    std::uint32_t flags = 0;
+    if (unsaturated > output)
+      flags |= PIDRecord::UPPER_CLAMP;
+    if (unsaturated < output)
+      flags |= PIDRecord::LOWER_CLAMP;
+    if (integration == Scalar(0.0))
+      flags |= PIDRecord::FROZEN;
+    return flags;
+  }
+
+  //! Structure to represent the telemetry binary file header
+  struct TelemetryHeader
+  {
+    char          magic[4];         //!< File magic ("PDLT")
+    std::uint32_t version;          //!< File format version
+    std::uint32_t record_size;      //!< Record size in bytes
+    std::uint32_t reserved;         //!< Reserved (zero)
+    double        ticks_per_second; //!< Telemetry clock frequency
+  };
+
+  static_assert(sizeof(TelemetryHeader) == 24, "TelemetryHeader binary layout must be 24 bytes");
+
+  //! Class to represent a telemetry channel, i.e. a preallocated lock-free
+  //! ring buffer of records written by one controller thread and read by one
+  //! drainer thread. Records pushed on a full channel are dropped and counted.
+  class TelemetryChannel
+  {
+  private:
+    RingBuffer<PIDRecord, PIDDLE_TELEMETRY_CAPACITY> m_ring;        //!< Records ring buffer
+    std::atomic<std::uint64_t>                       m_dropped{0}; //!< Number of dropped records
+
+  public:
+    //! Push a record (producer thread only), returns false if it is dropped
+    bool
+    push(
+      PIDRecord const & record //!< Record
+    )
+    {
+      if (this->m_ring.push(record))
+        return true;
+      this->m_dropped.store(this->m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    //! Pop a record (consumer thread only), returns false if the channel is empty
+    bool
+    pop(
+      PIDRecord & record //!< Record
+    )
+    {
+      return this->m_ring.pop(record);
+    }
+
+    //! Get the number of dropped records
+    std::uint64_t
+    dropped(void) const
+    {
+      return this->m_dropped.load(std::memory_order_relaxed);
+    }
+
+  }; // class TelemetryChannel
+
+  //! Class to represent a disabled telemetry probe (compiles to nothing)
+  class NoProbe
+  {
+  public:
+    static constexpr bool ENABLED = false; //!< Probe presence flag
+
+    //! Record a pid step (no-op)
+    template <typename Scalar>
+    void
+    record(Scalar, Scalar, Scalar, Scalar, Scalar, Scalar, std::uint32_t)
+    {
+    }
+
+  }; // class NoProbe
+
+  //! Class to represent a telemetry probe pushing pid step records into a
+  //! channel (nothing is recorded while no channel is attached). A copy keeps
+  //! the controller identifier but is detached from the channel, since a ring
+  //! buffer admits a single producer; a channel is attached by moving a probe.
+  class RingProbe
+  {
+  private:
+    std::shared_ptr<TelemetryChannel> m_channel; //!< Telemetry channel
+    std::uint32_t                     m_id = 0;  //!< Controller identifier
+
+  public:
+    static constexpr bool ENABLED = true; //!< Probe presence flag
+
+    //! Class constructor
+    RingProbe(
+      std::shared_ptr<TelemetryChannel> channel = nullptr, //!< Telemetry channel
+      std::uint32_t                     id      = 0        //!< Controller identifier
+    )
+      : m_channel(std::move(channel)), m_id(id)
+    {
+    }
+
+    //! Class copy constructor (the copy is detached from the channel)
+    RingProbe(
+      RingProbe const & other //!< Telemetry probe
+    )
+      : m_id(other.m_id)
+    {
+    }
+
+    //! Class move constructor
+    RingProbe(RingProbe &&) = default;
+
+    //! Copy assignment operator (the probe is detached from the channel)
+    RingProbe &
+    operator=(
+      RingProbe const & other //!< Telemetry probe
+    )
+    {
+      this->m_channel = nullptr;
+      this->m_id      = other.m_id;
+      return *this;
+    }
+
+    //! Move assignment operator
+    RingProbe & operator=(RingProbe &&) = default;
+
+    //! Get telemetry channel
+    std::shared_ptr<TelemetryChannel> const &
+    channel(void) const
+    {
+      return this->m_channel;
+    }
+
+    //! Get controller identifier
+    std::uint32_t
+    id(void) const
+    {
+      return this->m_id;
+    }
+
+    //! Record a pid step
+    template <typename Scalar>
+    void
+    record(
+      Scalar        error,        //!< Input error value
+      Scalar        proportional, //!< Proportional term
+      Scalar        integral,     //!< Integral term
+      Scalar        derivative,   //!< Derivative term
+      Scalar        unsaturated,  //!< Output before saturation
+      Scalar        output,       //!< Output after saturation
+      std::uint32_t flags         //!< Clamp state flags
+    )
+    {
+      if (!this->m_channel)
+        return;
+      PIDRecord record;
+      record.timestamp    = telemetry_ticks();
+      record.id           = this->m_id;
+      record.flags        = flags;
+      record.error        = static_cast<double>(error);
+      record.proportional = static_cast<double>(proportional);
+      record.integral     = static_cast<double>(integral);
+      record.derivative   = static_cast<double>(derivative);
+      record.unsaturated  = static_cast<double>(unsaturated);
+      record.output       = static_cast<double>(output);
+      this->m_channel->push(record);
+    }
+
+  }; // class RingProbe
+
+  //! Class to represent a background drainer writing the records of a set of
+  //! telemetry channels into a compact binary file (a TelemetryHeader
+  //! followed by raw PIDRecord entries)
+  class TelemetryDrainer
+  {
+  private:
+    static constexpr std::size_t BATCH = 256; //!< Records written per batch
+
+    std::vector<std::shared_ptr<TelemetryChannel>> m_channels;          //!< Drained channels
+    std::FILE *                                    m_file = nullptr;    //!< Output file
+    std::thread                                    m_thread;            //!< Drainer thread
+    std::atomic<bool>                              m_stop{false};       //!< Stop request flag
+    real                                           m_period;            //!< Drainer polling period (s)
+    std::atomic<std::uint64_t>                     m_records{0};        //!< Number of written records
+
+  public:
+    //! Class constructor (opens the file and writes the header)
+    TelemetryDrainer(
+      std::string const & path,                 //!< Output file path
+      real                period = real(1.0e-3) //!< Drainer polling period (s)
+    )
+      : m_period(period)
+    {
+      this->m_file = std::fopen(path.c_str(), "wb");
+      PIDDLE_ASSERT(this->m_file != nullptr, "Piddle::TelemetryDrainer(...): cannot open file '" << path << "'.");
+      TelemetryHeader header;
+      std::memcpy(header.magic, "PDLT", 4);
+      header.version          = 1;
+      header.record_size      = sizeof(PIDRecord);
+      header.reserved         = 0;
+      header.ticks_per_second = telemetry_ticks_per_second();
+      std::fwrite(&header, sizeof(header), 1, this->m_file);
+    }
+
+    //! Class destructor (stops the drainer, drains the channels and closes the file)
+    ~TelemetryDrainer(void)
+    {
+      this->stop();
+      this->drain();
+      std::fclose(this->m_file);
+    }
+
+    //! Deleted copy constructor
+    TelemetryDrainer(TelemetryDrainer const &) = delete;
+
+    //! Deleted copy assignment operator
+    TelemetryDrainer & operator=(TelemetryDrainer const &) = delete;
+
+    //! Add a channel to be drained (not while running)
+    void
+    add(
+      std::shared_ptr<TelemetryChannel> channel //!< Telemetry channel
+    )
+    {
+      PIDDLE_ASSERT(!this->m_thread.joinable(), "Piddle::TelemetryDrainer::add(...): drainer is running.");
+      this->m_channels.push_back(std::move(channel));
+    }
+
+    //! Get the number of written records
+    std::uint64_t
+    records(void) const
+    {
+      return this->m_records.load(std::memory_order_relaxed);
+    }
+
+    //! Start draining on a background thread
+    void
+    start(void)
+    {
+      PIDDLE_ASSERT(!this->m_thread.joinable(), "Piddle::TelemetryDrainer::start(...): drainer is already running.");
+      this->m_stop = false;
+      this->m_thread = std::thread([this]
+      {
+        while (!this->m_stop.load(std::memory_order_relaxed))
+        {
+          if (this->drain() == 0)
+            std::this_thread::sleep_for(std::chrono::duration<real>(this->m_period));
+        }
+      });
+    }
+
+    //! Stop the background drainer thread
+    void
+    stop(void)
+    {
+      this->m_stop = true;
+      if (this->m_thread.joinable())
+        this->m_thread.join();
+    }
+
+    //! Drain all the channels once and return the number of written records
+    //! (consumer side: not to be called while the background thread runs)
+    std::size_t
+    drain(void)
+    {
+      PIDRecord   batch[BATCH];
+      std::size_t written = 0;
+      for (std::shared_ptr<TelemetryChannel> & channel : this->m_channels)
+      {
+        std::size_t size = 0;
+        while (channel->pop(batch[size]))
+        {
+          if (++size == BATCH)
+          {
+            written += std::fwrite(batch, sizeof(PIDRecord), size, this->m_file);
+            size = 0;
+          }
+        }
+        written += std::fwrite(batch, sizeof(PIDRecord), size, this->m_file);
+      }
+      if (written > 0)
+        std::fflush(this->m_file);
+      this->m_records.fetch_add(written, std::memory_order_relaxed);
+      return written;
+    }
+
+  }; // class TelemetryDrainer
+
+  //! Convert a telemetry binary file into CSV (time in seconds from the first
+  //! record), returns the number of converted records
+  inline std::uint64_t
+  telemetry_to_csv(
+    std::string const & binary, //!< Input telemetry binary file path
+    std::ostream &      csv     //!< Output CSV stream
+  )
+  {
+    std::FILE * file = std::fopen(binary.c_str(), "rb");
+    PIDDLE_ASSERT(file != nullptr, "Piddle::telemetry_to_csv(...): cannot open file '" << binary << "'.");
+    TelemetryHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, "PDLT", 4) == 0 &&
+                 header.version == 1 &&
+                 header.record_size == sizeof(PIDRecord);
+    if (!valid)
+    {
+      std::fclose(file);
+      PIDDLE_ERROR("Piddle::telemetry_to_csv(...): invalid telemetry file '" << binary << "'.");
+    }
+    csv << "time,id,error,proportional,integral,derivative,unsaturated,output,upper_clamp,lower_clamp,frozen\n";
+    csv.precision(17);
+    PIDRecord     record;
+    std::uint64_t count = 0;
+    std::uint64_t start = 0;
+    while (std::fread(&record, sizeof(record), 1, file) == 1)
+    {
+      if (count++ == 0)
+        start = record.timestamp;
+      csv << double(std::int64_t(record.timestamp - start)) / header.ticks_per_second << ','
+          << record.id << ','
+          << record.error << ','
+          << record.proportional << ','
+          << record.integral << ','
+          << record.derivative << ','
+          << record.unsaturated << ','
+          << record.output << ','
+          << ((record.flags & PIDRecord::UPPER_CLAMP) ? 1 : 0) << ','
+          << ((record.flags & PIDRecord::LOWER_CLAMP) ? 1 : 0) << ','
+          << ((record.flags & PIDRecord::FROZEN) ? 1 : 0) << '\n';
+    }
+    std::fclose(file);
+    return count;
+  }
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Telemetry.hh
+///
@@ -0,0 +1,280 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: ThreadPool.hh
+///
+
+#ifndef INCLUDE_PIDDLE_THREADPOOL
+#define INCLUDE_PIDDLE_THREADPOOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Piddle
+{
+
+  //! Get the number of hardware threads (at least one, since the standard
+  //! allows std::thread::hardware_concurrency to return zero when unknown)
+  inline integer
+  hardware_threads(void)
+  {
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads > 0 ? integer(threads) : integer(1);
+  }
+
+  /*\
+   |   _____ _                        _ ____              _
+   |  |_   _| |__  _ __ ___  __ _  __| |  _ \  ___   ___ | |
+   |    | | | '_ \| '__/ _ \/ _` |/ _` | |_) |/ _ \ / _ \| |
+   |    | | | | | | | |  __/ (_| | (_| |  __/| (_) | (_) | |
+   |    |_| |_| |_|_|  \___|\__,_|\__,_|_|    \___/ \___/|_|
+   |
+  \*/
+
+  //! Class to represent a work-stealing thread pool running batches of
+  //! indexed tasks. Each batch is split into contiguous chunks, one per worker
+  //! queue; a worker pops tasks from the back of its own queue and steals
+  //! from the front of the other queues once its own is empty. Queues are
+  //! preallocated, so that running a batch does not allocate once their
+  //! capacity covers the batch size.
+  class ThreadPool
+  {
+  public:
+    typedef void (*Function)(void * context, integer task); //!< Type-erased task function
+
+  private:
+    //! Worker task queue
+    struct Queue
+    {
+      std::mutex           mutex;    //!< Queue mutex
+      std::vector<integer> tasks;    //!< Task indices
+      integer              head = 0; //!< First valid task position
+      integer              tail = 0; //!< One past the last valid task position
+    };
+
+    std::vector<std::thread>  m_threads;               //!< Worker threads
+    std::unique_ptr<Queue[]>  m_queues;                //!< Worker task queues
+    std::mutex                m_mutex;                 //!< Batch mutex
+    std::condition_variable   m_wake;                  //!< Batch start condition
+    std::condition_variable   m_done;                  //!< Batch completion condition
+    std::atomic<integer>      m_pending{0};            //!< Number of unfinished batch tasks
+    std::uint64_t             m_generation = 0;        //!< Batch generation counter
+    integer                   m_core       = 0;        //!< Core of the first pinned worker
+    bool                      m_stop       = false;    //!< Stop request flag
+    Function                  m_function   = nullptr;  //!< Current batch task function
+    void *                    m_context    = nullptr;  //!< Current batch task context
+
+  public:
+    //! Class constructor, zero threads run the batches on the calling thread
+    ThreadPool(
+      integer threads = hardware_threads(), //!< Number of worker threads
+      bool    pin     = false,              //!< Pin worker i to core (core + i) (Linux only)
+      integer core    = 0                   //!< Core of the first pinned worker
+    )
+      : m_core(core)
+    {
+      PIDDLE_ASSERT(threads >= 0, "Piddle::ThreadPool(...): negative number of threads " << threads << ".");
+      this->m_queues.reset(new Queue[std::size_t(threads > 0 ? threads : 1)]);
+      for (integer i = 0; i < threads; ++i)
+        this->m_threads.emplace_back(&ThreadPool::worker, this, i, pin);
+    }
+
+    //! Class destructor
+    ~ThreadPool(void)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_stop = true;
+      }
+      this->m_wake.notify_all();
+      for (std::thread & thread : this->m_threads)
+        thread.join();
+    }
+
+    //! Deleted copy constructor
+    ThreadPool(ThreadPool const &) = delete;
+
+    //! Deleted copy assignment operator
+    ThreadPool & operator=(ThreadPool const &) = delete;
+
+    //! Get the number of worker threads
+    integer
+    size(void) const
+    {
+      return integer(this->m_threads.size());
+    }
+
+    //! Run the tasks f(0), ..., f(tasks-1) and wait for their completion.
+    //! Every task is run exactly once, by a single thread.
+    template <typename Task>
+    void
+    run(
+      integer tasks, //!< Number of tasks
+      Task &  f      //!< Task functor, called as f(task)
+    )
+    {
+      this->run(tasks, [](void * context, integer task) {(*static_cast<Task *>(context))(task);}, &f);
+    }
+
+    //! Run the tasks function(context, 0), ..., function(context, tasks-1)
+    //! and wait for their completion
+    void
+    run(
+      integer  tasks,    //!< Number of tasks
+      Function function, //!< Task function
+      void *   context   //!< Task function context
+    )
+    {
+      if (tasks <= 0)
+        return;
+      integer workers = this->size();
+      if (workers == 0)
+      {
+        for (integer task = 0; task < tasks; ++task)
+          function(context, task);
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_function = function;
+        this->m_context  = context;
+        this->m_pending.store(tasks, std::memory_order_relaxed);
+        // Contiguous chunks keep neighbouring tasks on the same worker
+        for (integer i = 0; i < workers; ++i)
+        {
+          Queue & queue = this->m_queues[i];
+          std::lock_guard<std::mutex> queue_lock(queue.mutex);
+          integer begin = (tasks * i) / workers;
+          integer end   = (tasks * (i + 1)) / workers;
+          if (queue.tasks.size() < std::size_t(end - begin))
+            queue.tasks.resize(std::size_t(end - begin));
+          for (integer task = begin; task < end; ++task)
+            queue.tasks[task - begin] = task;
+          queue.head = 0;
+          queue.tail = end - begin;
+        }
+        ++this->m_generation;
+      }
+      this->m_wake.notify_all();
+
+      std::unique_lock<std::mutex> lock(this->m_mutex);
+      this->m_done.wait(lock, [this] {return this->m_pending.load(std::memory_order_acquire) == 0;});
+    }
+
+  private:
+    //! Worker thread loop
+    void
+    worker(
+      integer id, //!< Worker index
+      bool    pin //!< Pin worker to a core
+    )
+    {
+#if defined(__linux__)
+      if (pin)
+      {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(unsigned(this->m_core + id) % unsigned(hardware_threads()), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      }
+#else
+      (void) pin;
+#endif
+      std::uint64_t generation = 0;
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(this->m_mutex);
+          this->m_wake.wait(lock, [this, generation] {return this->m_stop || this->m_generation != generation;});
+          if (this->m_stop)
+            return;
+          generation = this->m_generation;
+        }
+        integer task;
+        while (this->pop(id, task) || this->steal(id, task))
+        {
+          this->m_function(this->m_context, task);
+          if (this->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_done.notify_all();
+          }
+        }
+      }
+    }
+
+    //! Pop a task from the back of the worker own queue
+    bool
+    pop(
+      integer   id,  //!< Worker index
+      integer & task //!< Popped task
+    )
+    {
+      Queue & queue = this->m_queues[id];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.head == queue.tail)
+        return false;
+      task = queue.tasks[--queue.tail];
+      return true;
+    }
+
+    //! Steal a task from the front of another worker queue
+    bool
+    steal(
+      integer   id,  //!< Worker index
+      integer & task //!< Stolen task
+    )
+    {
+      integer workers = this->size();
+      for (integer k = 1; k < workers; ++k)
+      {
+        Queue & queue = this->m_queues[(id + k) % workers];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head != queue.tail)
+        {
+          task = queue.tasks[queue.head++];
+          return true;
+        }
+      }
+      return false;
+    }
+
+  }; // class ThreadPool
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: ThreadPool.hh
+///
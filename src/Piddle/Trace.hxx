@@ -0,0 +1,180 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Trace.hh
+///
+
+#ifndef INCLUDE_PIDDLE_TRACE
+#define INCLUDE_PIDDLE_TRACE
+
+#include "Block.hxx"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Piddle
+{
+
+  /*\
+   |   _____
+   |  |_   _| __ __ _  ___  ___
+   |    | || '__/ _` |/ __|/ _ \
+   |    | || | | (_| | (__|  __/
+   |    |_||_|  \__,_|\___|\___|
+   |
+  \*/
+
+  //! Class to represent a recorded trace file (a headerless array of native
+  //! real values) mapped read-only into memory. Samples are accessed in place
+  //! without copying, and can be streamed through a block in cache-sized
+  //! chunks.
+  class MappedTrace
+  {
+  public:
+    static constexpr std::size_t CHUNK = 4096; //!< Default chunk size (samples)
+
+  private:
+    void *                m_map   = nullptr; //!< Mapped memory
+    std::size_t           m_bytes = 0;       //!< Mapped size (bytes)
+    std::span<real const> m_samples;         //!< Mapped samples
+
+  public:
+    //! Class constructor (maps the whole file)
+    MappedTrace(
+      std::string const & path //!< Trace file path
+    )
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      int fd = ::open(path.c_str(), O_RDONLY);
+      PIDDLE_ASSERT(fd >= 0, "Piddle::MappedTrace(...): cannot open file '" << path << "'.");
+      struct stat info;
+      if (::fstat(fd, &info) != 0 || std::size_t(info.st_size) % sizeof(real) != 0)
+      {
+        ::close(fd);
+        PIDDLE_ERROR("Piddle::MappedTrace(...): file '" << path << "' is not an array of real values.");
+      }
+      this->m_bytes = std::size_t(info.st_size);
+      if (this->m_bytes > 0)
+      {
+        this->m_map = ::mmap(nullptr, this->m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        PIDDLE_ASSERT(this->m_map != MAP_FAILED, "Piddle::MappedTrace(...): cannot map file '" << path << "'.");
+        ::madvise(this->m_map, this->m_bytes, MADV_SEQUENTIAL);
+        this->m_samples = std::span<real const>(static_cast<real const *>(this->m_map), this->m_bytes / sizeof(real));
+      }
+      else
+      {
+        ::close(fd);
+      }
+#else
+      PIDDLE_ERROR("Piddle::MappedTrace(...): memory-mapped traces are not supported on this platform.");
+#endif
+    }
+
+    //! Class destructor (unmaps the file)
+    ~MappedTrace(void)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      if (this->m_map != nullptr)
+        ::munmap(this->m_map, this->m_bytes);
+#endif
+    }
+
+    //! Deleted copy constructor
+    MappedTrace(MappedTrace const &) = delete;
+
+    //! Deleted copy assignment operator
+    MappedTrace & operator=(MappedTrace const &) = delete;
+
+    //! Get the mapped samples
+    std::span<real const>
+    samples(void) const
+    {
+      return this->m_samples;
+    }
+
+    //! Get the number of samples
+    std::size_t
+    size(void) const
+    {
+      return this->m_samples.size();
+    }
+
+    //! Stream the samples through a block in chunks. The time steps span holds
+    //! either a single fixed time step or one time step per sample (e.g. the
+    //! samples of another trace). Each output chunk is passed to the sink,
+    //! called as sink(offset, outputs), and is only valid during the call.
+    template <typename Sink>
+    void
+    process(
+      Block &               block,              //!< Block to be evaluated
+      std::span<real const> dt,                 //!< Time steps (one fixed or one per sample)
+      Sink &&               sink,               //!< Output chunks sink
+      std::size_t           chunk = CHUNK       //!< Chunk size (samples)
+    )
+    const
+    {
+      PIDDLE_ASSERT(chunk > 0, "Piddle::MappedTrace::process(...): null chunk size.");
+      PIDDLE_ASSERT(dt.size() == 1 || dt.size() == this->size(),
+        "Piddle::MappedTrace::process(...): time steps size " << dt.size() << " is neither 1 nor the trace size " << this->size() << ".");
+      std::vector<real> buffer(std::min(chunk, this->size()));
+      for (std::size_t base = 0; base < this->size(); base += chunk)
+      {
+        std::size_t     n      = std::min(chunk, this->size() - base);
+        std::span<real> output(buffer.data(), n);
+        block.process(this->m_samples.subspan(base, n), dt.size() == 1 ? dt : dt.subspan(base, n), output);
+        sink(base, std::span<real const>(output));
+      }
+    }
+
+  }; // class MappedTrace
+
+  //! Write samples into a trace file readable by MappedTrace
+  inline void
+  write_trace(
+    std::string const &   path,   //!< Trace file path
+    std::span<real const> samples //!< Samples
+  )
+  {
+    std::FILE * file = std::fopen(path.c_str(), "wb");
+    PIDDLE_ASSERT(file != nullptr, "Piddle::write_trace(...): cannot open file '" << path << "'.");
+    std::size_t written = std::fwrite(samples.data(), sizeof(real), samples.size(), file);
+    std::fclose(file);
+    PIDDLE_ASSERT(written == samples.size(), "Piddle::write_trace(...): cannot write file '" << path << "'.");
+  }
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: Trace.hh
+///
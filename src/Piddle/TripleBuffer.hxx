@@ -0,0 +1,157 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: TripleBuffer.hh
+///
+
+#ifndef INCLUDE_PIDDLE_TRIPLEBUFFER
+#define INCLUDE_PIDDLE_TRIPLEBUFFER
+
+#include <atomic>
+#include <cstdint>
+
+namespace Piddle
+{
+
+  /*\
+   |   _____     _       _      ____         __  __
+   |  |_   _| __(_)_ __ | | ___| __ ) _   _ / _|/ _| ___ _ __
+   |    | || '__| | '_ \| |/ _ \  _ \| | | | |_| |_ / _ \ '__|
+   |    | || |  | | |_) | |  __/ |_) | |_| |  _|  _|  __/ |
+   |    |_||_|  |_| .__/|_|\___|____/ \__,_|_| |_|  \___|_|
+   |              |_|
+  \*/
+
+  //! Class to represent a wait-free single-producer single-consumer triple
+  //! buffer. The writer fills the back slot and publishes it with a single
+  //! atomic exchange; the reader picks up the latest published slot with a
+  //! single atomic exchange, and only when a new one is available. Neither
+  //! side ever blocks, allocates, or observes a partially written value.
+  //! Each published value is tagged with an increasing version number.
+  template <typename T>
+  class TripleBuffer
+  {
+  private:
+    static constexpr std::uint8_t INDEX = 0x3; //!< Slot index bits
+    static constexpr std::uint8_t DIRTY = 0x4; //!< New value available bit
+
+    //! Buffer slot
+    struct Slot
+    {
+      T             value{};     //!< Slot value
+      std::uint64_t version = 0; //!< Slot version
+    };
+
+    Slot m_slots[3]; //!< Buffer slots
+
+    alignas(64) std::atomic<std::uint8_t> m_middle{1}; //!< Shared slot index and dirty bit
+    alignas(64) std::uint8_t  m_back    = 0;           //!< Writer slot index
+    std::uint64_t             m_version = 0;           //!< Writer version counter
+    alignas(64) std::uint8_t  m_front   = 2;           //!< Reader slot index
+
+  public:
+    //! Class constructor
+    TripleBuffer(
+      T const & value = T() //!< Initial value
+    )
+    {
+      for (Slot & slot : this->m_slots)
+        slot.value = value;
+    }
+
+    //! Deleted copy constructor
+    TripleBuffer(TripleBuffer const &) = delete;
+
+    //! Deleted copy assignment operator
+    TripleBuffer & operator=(TripleBuffer const &) = delete;
+
+    //! Get the writer slot value reference (writer thread only)
+    T &
+    back(void)
+    {
+      return this->m_slots[this->m_back].value;
+    }
+
+    //! Publish the writer slot value (writer thread only), returns its version
+    std::uint64_t
+    publish(void)
+    {
+      Slot & slot  = this->m_slots[this->m_back];
+      slot.version = ++this->m_version;
+      this->m_back = this->m_middle.exchange(std::uint8_t(this->m_back | DIRTY), std::memory_order_acq_rel) & INDEX;
+      return this->m_version;
+    }
+
+    //! Copy a value into the writer slot and publish it (writer thread only),
+    //! returns its version
+    std::uint64_t
+    publish(
+      T const & value //!< Value to be published
+    )
+    {
+      this->back() = value;
+      return this->publish();
+    }
+
+    //! Check if a value has been published and not yet picked up
+    bool
+    is_dirty(void) const
+    {
+      return (this->m_middle.load(std::memory_order_relaxed) & DIRTY) != 0;
+    }
+
+    //! Pick up the latest published value if any (reader thread only),
+    //! returns true if the reader slot changed
+    bool
+    update(void)
+    {
+      if (!this->is_dirty())
+        return false;
+      this->m_front = this->m_middle.exchange(this->m_front, std::memory_order_acq_rel) & INDEX;
+      return true;
+    }
+
+    //! Get the reader slot value const reference (reader thread only)
+    T const &
+    front(void) const
+    {
+      return this->m_slots[this->m_front].value;
+    }
+
+    //! Get the reader slot version, zero if nothing has been picked up yet
+    //! (reader thread only)
+    std::uint64_t
+    version(void) const
+    {
+      return this->m_slots[this->m_front].version;
+    }
+
+  }; // class TripleBuffer
+
+} // namespace Piddle
+
+#endif
+
+///
+/// eof: TripleBuffer.hh
+///
@@ -0,0 +1,214 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Autotune.cc
+///
+
+// Autotuning checks: the tuner results must not depend on the number of
+// threads, the relay feedback experiment must match the exact relay limit
+// cycle of a first order plus dead time plant and recover the analytic
+// ultimate point of a second order plus dead time plant (whose oscillation is
+// close enough to a sine wave for the describing function), and the
+// Ziegler-Nichols rules must return the textbook table entries.
+// Build:
+//   g++ -std=c++20 -O2 -pthread -I src tests/Autotune.cc
+
+#include "Piddle.hh"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+using namespace Piddle;
+
+//! Check if two parameter sets are equal bit by bit
+static bool
+same(
+  PIDParameters const & a, //!< First parameter set
+  PIDParameters const & b  //!< Second parameter set
+)
+{
+  return std::memcmp(&a, &b, sizeof(PIDParameters)) == 0;
+}
+
+//! Analytic ultimate point (gain and period) of a frequency response, found
+//! by bisection of the -180 degrees phase crossing in [low, high] rad/s
+static void
+ultimate_point(
+  std::function<std::complex<real>(real)> const & response, //!< Frequency response G(j*w)
+  real                                            low,      //!< Lower frequency bound (rad/s)
+  real                                            high,     //!< Upper frequency bound (rad/s)
+  real &                                          gain,     //!< Ultimate gain
+  real &                                          period    //!< Ultimate period (s)
+)
+{
+  // The unwrapped phase is continuous, so the imaginary part of G changes
+  // sign at the crossing while the real part is negative
+  for (integer i = 0; i < 200; ++i)
+  {
+    real middle = 0.5 * (low + high);
+    (response(middle).imag() < 0.0 ? low : high) = middle;
+  }
+  real w = 0.5 * (low + high);
+  gain   = 1.0 / std::abs(response(w));
+  period = 2.0 * PI / w;
+}
+
+int
+main(void)
+{
+  integer failures = 0;
+
+  // Same best parameters with any number of threads, for both searches
+  {
+    FirstOrderPlant plant(2.0, 1.5, 0.2);
+    PID             controller(1.0, 0.5, 0.0, 0.0, 5.0, -5.0);
+    TuningBounds    bounds;
+    bounds.lower       = controller.parameters();
+    bounds.upper       = controller.parameters();
+    bounds.lower.kp    = 0.1;
+    bounds.upper.kp    = 5.0;
+    bounds.lower.ki    = 0.0;
+    bounds.upper.ki    = 5.0;
+    bounds.lower.kd    = 0.0;
+    bounds.upper.kd    = 1.0;
+    TuningResult grid_reference, simplex_reference;
+    for (integer threads : {0, 1, 2, 4})
+    {
+      Autotuner<FirstOrderPlant> tuner(plant, controller, bounds, 42, threads);
+      tuner.scenario().duration = 5.0;
+      TuningResult grid    = tuner.grid(6);
+      TuningResult simplex = tuner.nelder_mead(6, 60);
+      if (threads == 0)
+      {
+        grid_reference    = grid;
+        simplex_reference = simplex;
+      }
+      bool ok = same(grid.parameters, grid_reference.parameters) && grid.evaluations == grid_reference.evaluations &&
+                same(simplex.parameters, simplex_reference.parameters) &&
+                simplex.evaluations == simplex_reference.evaluations && std::isfinite(simplex.metrics.cost) &&
+                !(simplex.metrics.cost > grid.metrics.cost);
+      std::printf("Autotuner %d threads: grid kp %.6f ki %.6f kd %.6f cost %.6f, nelder-mead kp %.6f ki %.6f "
+                  "kd %.6f cost %.6f%s\n", threads, grid.parameters.kp, grid.parameters.ki, grid.parameters.kd,
+                  grid.metrics.cost, simplex.parameters.kp, simplex.parameters.ki, simplex.parameters.kd,
+                  simplex.metrics.cost, ok ? "" : " FAILED");
+      failures += !ok;
+    }
+  }
+
+  // Relay feedback on a first order plus dead time plant: the limit cycle is
+  // known in closed form (output amplitude d*K*(1 - exp(-L/T)) and period
+  // 2*L + 2*T*log(2 - exp(-L/T))), while the describing function gain is
+  // biased low by the non-sinusoidal waveform, so only the period is checked
+  // against the ultimate point
+  {
+    real const K = 1.5, T = 2.0, L = 0.5, d = 1.0;
+    FirstOrderPlant first(K, T, L);
+    real            gain, period;
+    ultimate_point([=](real w) {
+      return K * std::exp(std::complex<real>(0.0, -w * L)) / std::complex<real>(1.0, w * T);
+    }, 1.0e-3, PI / L, gain, period);
+    RelayEstimate estimate  = relay_feedback(first, d, 0.0, 1.0e-3, 100.0);
+    real          amplitude = d * K * (1.0 - std::exp(-L / T));
+    real          cycle     = 2.0 * L + 2.0 * T * std::log(2.0 - std::exp(-L / T));
+    real          e_amp     = estimate.amplitude / amplitude - 1.0;
+    real          e_cycle   = estimate.ultimate_period / cycle - 1.0;
+    real          e_gain    = estimate.ultimate_gain / (4.0 * d / (PI * amplitude)) - 1.0;
+    real          e_period  = estimate.ultimate_period / period - 1.0;
+    bool          ok        = estimate.valid && std::abs(e_amp) < 0.01 && std::abs(e_cycle) < 0.01 &&
+                              std::abs(e_gain) < 0.01 && std::abs(e_period) < 0.02;
+    std::printf("relay, first order: amplitude %.4f (exact %.4f, %+.2f%%), period %.4f (exact %.4f, %+.2f%%), "
+                "Ku %.4f (ultimate %.4f, %+.1f%%), Tu %+.2f%% from ultimate%s\n",
+                estimate.amplitude, amplitude, 100.0 * e_amp, estimate.ultimate_period, cycle, 100.0 * e_cycle,
+                estimate.ultimate_gain, gain, 100.0 * (estimate.ultimate_gain / gain - 1.0), 100.0 * e_period,
+                ok ? "" : " FAILED");
+    failures += !ok;
+  }
+  {
+    real const K = 2.0, wn = 3.0, zeta = 0.7, L = 0.3;
+    SecondOrderPlant second(K, wn, zeta, L);
+    real             gain, period;
+    ultimate_point([=](real w) {
+      return K * wn * wn * std::exp(std::complex<real>(0.0, -w * L)) /
+             std::complex<real>(wn * wn - w * w, 2.0 * zeta * wn * w);
+    }, 1.0e-3, PI / L, gain, period);
+    RelayEstimate estimate = relay_feedback(second, 1.0, 0.0, 1.0e-3, 100.0);
+    real          e_gain   = estimate.ultimate_gain / gain - 1.0;
+    real          e_period = estimate.ultimate_period / period - 1.0;
+    bool          ok       = estimate.valid && std::abs(e_gain) < 0.06 && std::abs(e_period) < 0.01;
+    std::printf("relay, second order: Ku %.4f (analytic %.4f, %+.1f%%), Tu %.4f (analytic %.4f, %+.1f%%)%s\n",
+                estimate.ultimate_gain, gain, 100.0 * e_gain, estimate.ultimate_period, period, 100.0 * e_period,
+                ok ? "" : " FAILED");
+    failures += !ok;
+  }
+
+  // Ziegler-Nichols table (gain, integral time and derivative time as
+  // fractions of the ultimate gain and period)
+  {
+    RelayEstimate estimate;
+    estimate.ultimate_gain   = 2.0;
+    estimate.ultimate_period = 4.0;
+    estimate.valid           = true;
+    struct Entry {ZieglerNichols rule; char const * name; real kp, ti, td;};
+    Entry const table[] = {
+      {ZN_P,              "P",              0.50, 0.0,       0.0      },
+      {ZN_PI,             "PI",             0.45, 1.0 / 1.2, 0.0      },
+      {ZN_PID,            "PID",            0.60, 0.5,       0.125    },
+      {ZN_PESSEN,         "Pessen",         0.70, 0.4,       0.15     },
+      {ZN_SOME_OVERSHOOT, "some overshoot", 0.33, 0.5,       1.0 / 3.0},
+      {ZN_NO_OVERSHOOT,   "no overshoot",   0.20, 0.5,       1.0 / 3.0}
+    };
+    for (Entry const & entry : table)
+    {
+      PIDParameters p  = ziegler_nichols(estimate, entry.rule);
+      real          kp = entry.kp * estimate.ultimate_gain;
+      real          ki = entry.ti > 0.0 ? kp / (entry.ti * estimate.ultimate_period) : 0.0;
+      real          kd = kp * entry.td * estimate.ultimate_period;
+      bool          ok = std::abs(p.kp - kp) <= 1.0e-12 * kp && std::abs(p.ki - ki) <= 1.0e-12 * ki &&
+                         std::abs(p.kd - kd) <= 1.0e-12 * kd;
+      std::printf("Ziegler-Nichols %-14s kp %.4f ki %.4f kd %.4f%s\n", entry.name, p.kp, p.ki, p.kd,
+                  ok ? "" : " FAILED");
+      failures += !ok;
+    }
+    bool rejected = false;
+    try
+    {
+      ziegler_nichols(RelayEstimate());
+    }
+    catch (std::runtime_error const &)
+    {
+      rejected = true;
+    }
+    std::printf("Ziegler-Nichols on an invalid estimate: %s\n", rejected ? "rejected" : "accepted FAILED");
+    failures += !rejected;
+  }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Autotune.cc
+///
@@ -0,0 +1,131 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Butterworth.cc
+///
+
+// Frequency response and batch processing of the Butterworth filter.
+// Build:
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src tests/Butterworth.cc
+
+#include "Piddle.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Piddle;
+
+//! Steady-state gain of a filter at a frequency, measured by correlating the
+//! response over whole periods after the transient has decayed
+static real
+gain(
+  integer order, //!< Filter order
+  real    fc,    //!< Cut-off frequency (Hz)
+  real    f,     //!< Input frequency (Hz)
+  real    dt     //!< Time step
+)
+{
+  Butterworth filter(order, fc);
+  integer     period = integer(std::lround(1.0 / (f * dt)));
+  integer     settle = 200 * period;
+  real        c = 0.0, s = 0.0;
+  for (integer k = 0; k < settle + 10 * period; ++k)
+  {
+    real phase = 2.0 * PI * f * dt * real(k);
+    real y     = filter.setup(std::sin(phase), dt);
+    if (k >= settle)
+    {
+      s += y * std::sin(phase);
+      c += y * std::cos(phase);
+    }
+  }
+  return 2.0 * std::hypot(s, c) / real(10 * period);
+}
+
+int
+main(void)
+{
+  integer failures = 0;
+  real    dt       = 1.0e-3;
+
+  // Unit gain at DC and -3 dB at the cut-off frequency (exact for the
+  // prewarped bilinear transform) for every order
+  for (integer order = BasicButterworth<real>::MIN_ORDER; order <= BasicButterworth<real>::MAX_ORDER; ++order)
+  {
+    Butterworth filter(order, 50.0);
+    real        dc = 0.0;
+    for (integer k = 0; k < 5000; ++k)
+      dc = filter.setup(1.0, dt);
+    real cutoff = gain(order, 50.0, 50.0, dt);
+    bool ok     = std::abs(dc - 1.0) < 1.0e-9 && std::abs(cutoff - std::sqrt(0.5)) < 1.0e-6;
+    std::printf("Butterworth order %d: DC gain %.12f, gain at fc %.9f (expected %.9f)%s\n",
+                order, dc, cutoff, std::sqrt(0.5), ok ? "" : " FAILED");
+    failures += !ok;
+  }
+
+  // A filter without a cut-off frequency holds its output instead of throwing
+  Butterworth idle;
+  real        held = idle.setup(1.0, dt);
+  bool        ok   = held == 0.0;
+  std::printf("Butterworth without cut-off frequency: output %g%s\n", held, ok ? "" : " FAILED");
+  failures += !ok;
+
+  // Batch processing matches the per-sample calls bit by bit, also across
+  // time step changes and in place
+  std::mt19937_64                      rng(5);
+  std::uniform_real_distribution<real> U(-1.0, 1.0);
+  std::vector<real> input(10000), steps(input.size()), batch(input.size());
+  for (std::size_t k = 0; k < input.size(); ++k)
+  {
+    input[k] = U(rng);
+    steps[k] = k < 4000 ? 1.0e-3 : (k < 7000 ? 2.0e-3 : 1.0e-3);
+  }
+  Butterworth sample(5, 40.0), fixed(5, 40.0), varying(5, 40.0);
+  std::size_t mismatches = 0;
+  fixed.process(input, std::span<real const>(&dt, 1), batch);
+  for (std::size_t k = 0; k < input.size(); ++k)
+  {
+    real y = sample.setup(input[k], dt);
+    mismatches += std::memcmp(&y, &batch[k], sizeof(real)) != 0;
+  }
+  sample.reset();
+  batch = input;
+  varying.process(batch, steps, batch);
+  for (std::size_t k = 0; k < input.size(); ++k)
+  {
+    real y = sample.setup(input[k], steps[k]);
+    mismatches += std::memcmp(&y, &batch[k], sizeof(real)) != 0;
+  }
+  std::printf("Butterworth batch: %zu mismatches out of %zu samples\n", mismatches, 2 * input.size());
+  failures += mismatches != 0;
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Butterworth.cc
+///
@@ -0,0 +1,271 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Checkpoint.cc
+///
+
+// State file recovery and rejection checks: a torn or corrupted newest slot
+// falls back to the other slot, foreign, newer and truncated files are
+// rejected and left untouched, a rejected restore rolls every object back,
+// and a delay line head out of range is rejected.
+// Build:
+//   g++ -std=c++20 -O2 -I src tests/Checkpoint.cc
+
+#include "Piddle.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Piddle;
+
+// State file layout of a 4096 bytes slot capacity: a 64 bytes file header,
+// then two cache line aligned slots, each one a 32 bytes slot header (the
+// sequence number first) followed by the payload
+static constexpr std::size_t   CAPACITY = 4096;
+static constexpr std::size_t   HEADER   = 64;
+static constexpr std::size_t   STRIDE   = (32 + CAPACITY + 63) / 64 * 64;
+static constexpr std::uint16_t NEWER    = CheckpointFile::VERSION + 1;
+
+static integer failures = 0; //!< Number of failed checks
+
+//! Report a check
+static void
+check(
+  bool         ok,  //!< Check result
+  char const * what //!< Check description
+)
+{
+  std::printf("%s%s\n", what, ok ? "" : " FAILED");
+  failures += !ok;
+}
+
+//! Get the saved state bytes of an object
+template <typename Object>
+static std::vector<std::uint8_t>
+state(
+  Object const & object //!< Object with a save method
+)
+{
+  StateWriter writer;
+  object.save(writer);
+  return std::vector<std::uint8_t>(writer.data().begin(), writer.data().end());
+}
+
+//! Get the bytes of a snapshot
+static std::vector<std::uint8_t>
+bytes(
+  std::span<std::uint8_t const> data //!< Snapshot bytes
+)
+{
+  return std::vector<std::uint8_t>(data.begin(), data.end());
+}
+
+//! Read a whole file
+static std::vector<char>
+read_file(
+  std::string const & path //!< File path
+)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+//! Overwrite bytes of a file at an offset
+static void
+patch_file(
+  std::string const & path,   //!< File path
+  std::size_t         offset, //!< Byte offset
+  void const *        data,   //!< Bytes
+  std::size_t         size    //!< Number of bytes
+)
+{
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(std::streamoff(offset));
+  file.write(static_cast<char const *>(data), std::streamsize(size));
+}
+
+//! Check that opening a file is rejected with a message and leaves it untouched
+static void
+check_rejected(
+  std::string const & path,    //!< File path
+  char const *        message, //!< Expected message fragment
+  char const *        what     //!< Check description
+)
+{
+  std::vector<char> before = read_file(path);
+  std::string       error;
+  try
+  {
+    CheckpointFile file(path, CAPACITY);
+  }
+  catch (std::runtime_error const & exception)
+  {
+    error = exception.what();
+  }
+  check(error.find(message) != std::string::npos && read_file(path) == before, what);
+}
+
+int
+main(void)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path();
+  std::string           path      = (directory / "piddle_checkpoint_test.state").string();
+  std::string           foreign   = (directory / "piddle_checkpoint_test.txt").string();
+  std::filesystem::remove(path);
+
+  // Two snapshots: the first (sequence 1) goes to slot 1, the second
+  // (sequence 2) to slot 0
+  PID pid(1.3, 0.7, 0.05, 30.0, 1.0, -1.0);
+  std::vector<std::uint8_t> first, second;
+  {
+    Checkpoint checkpoint(path, CAPACITY);
+    checkpoint.add(pid);
+    pid.setup(0.5, 1.0e-3);
+    checkpoint.save();
+    first = bytes(checkpoint.file().latest());
+    pid.setup(0.7, 1.0e-3);
+    checkpoint.save(true);
+    second = bytes(checkpoint.file().latest());
+  }
+  {
+    CheckpointFile file(path);
+    check(file.sequence() == 2 && bytes(file.latest()) == second, "reopened file restores the newest snapshot");
+  }
+
+  // Corrupted payload of the newest slot
+  std::uint8_t flipped = std::uint8_t(second[second.size() / 2] ^ 0xFF);
+  patch_file(path, HEADER + 32 + second.size() / 2, &flipped, 1);
+  {
+    CheckpointFile file(path);
+    check(file.sequence() == 1 && bytes(file.latest()) == first, "corrupted newest slot falls back to the other slot");
+
+    // The next write replaces the corrupted slot, not the surviving one
+    file.write(second);
+    CheckpointFile reopened(path);
+    check(reopened.sequence() == 2 && bytes(reopened.latest()) == second, "write after a fallback keeps the older slot");
+  }
+
+  // Torn write of the newest slot (crash after its sequence was cleared)
+  std::uint64_t zero = 0;
+  patch_file(path, HEADER, &zero, sizeof(zero));
+  {
+    CheckpointFile file(path);
+    check(file.sequence() == 1 && bytes(file.latest()) == first, "torn newest slot falls back to the other slot");
+  }
+
+  // Both slots invalid
+  patch_file(path, HEADER + STRIDE, &zero, sizeof(zero));
+  {
+    Checkpoint checkpoint(path);
+    checkpoint.add(pid);
+    std::vector<std::uint8_t> before = state(pid);
+    check(!checkpoint.restore() && state(pid) == before, "file without valid slots restores nothing");
+  }
+
+  // Foreign, newer and truncated files are rejected and left untouched
+  {
+    std::ofstream text(foreign);
+    text << "not a state file, but still worth keeping\n";
+  }
+  check_rejected(foreign, "is not a state file", "foreign file rejected and untouched");
+  std::uint16_t version = NEWER;
+  patch_file(path, 4, &version, sizeof(version));
+  check_rejected(path, "unsupported state file version", "newer file version rejected and untouched");
+  version = CheckpointFile::VERSION;
+  patch_file(path, 4, &version, sizeof(version));
+  std::filesystem::resize_file(path, HEADER + STRIDE);
+  check_rejected(path, "truncated or corrupted", "truncated file rejected and untouched");
+  std::filesystem::remove(path);
+
+  // A snapshot that does not match the registered objects is rejected and
+  // every object is rolled back, including those restored before the mismatch
+  {
+    PID           saved_pid(2.0, 1.0, 0.0, 0.0, 3.0, -3.0);
+    MovingAverage saved_average(8);
+    Checkpoint    writer(path, CAPACITY);
+    writer.add(saved_pid);
+    writer.add(saved_average);
+    saved_pid.setup(1.0, 1.0e-3);
+    saved_average.setup(1.0, 1.0e-3);
+    writer.save();
+
+    PID           other_pid(2.0, 1.0, 0.0, 0.0, 3.0, -3.0);
+    MovingAverage other_average(16);
+    other_pid.setup(-0.25, 1.0e-3);
+    other_average.setup(-0.25, 1.0e-3);
+    std::vector<std::uint8_t> pid_before     = state(other_pid);
+    std::vector<std::uint8_t> average_before = state(other_average);
+    Checkpoint                reader(path, CAPACITY);
+    reader.add(other_pid);
+    reader.add(other_average);
+    bool rejected = false;
+    try
+    {
+      reader.restore();
+    }
+    catch (std::runtime_error const &)
+    {
+      rejected = true;
+    }
+    check(rejected && state(other_pid) == pid_before && state(other_average) == average_before,
+          "mismatched snapshot rejected and every object rolled back");
+  }
+  std::filesystem::remove(path);
+
+  // A dead time record with its delay line head out of range is rejected and
+  // the delay line is left as it was
+  {
+    DeadTime delay(0.01);
+    for (integer k = 0; k < 15; ++k)
+      delay.setup(real(k), 1.0e-3);
+    std::vector<std::uint8_t> record = state(delay);
+    std::uint64_t             head   = 10;
+    std::memcpy(record.data() + record.size() - sizeof(head), &head, sizeof(head));
+    DeadTime target(0.01);
+    target.setup(42.0, 1.0e-3);
+    std::vector<std::uint8_t> before = state(target);
+    bool                      rejected = false;
+    try
+    {
+      StateReader reader(record);
+      target.restore(reader);
+    }
+    catch (std::runtime_error const &)
+    {
+      rejected = true;
+    }
+    check(rejected && state(target) == before, "dead time head out of range rejected");
+  }
+
+  std::filesystem::remove(foreign);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Checkpoint.cc
+///
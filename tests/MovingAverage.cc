@@ -0,0 +1,83 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: MovingAverage.cc
+///
+
+// Drift of the moving average running sum against the direct window mean.
+// Build:
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src tests/MovingAverage.cc
+
+#include "Piddle.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace Piddle;
+
+int
+main(void)
+{
+  std::mt19937_64                      rng(11);
+  std::uniform_real_distribution<real> U(-1.0, 1.0);
+
+  // Samples with a large offset and a wide dynamic range, so that an
+  // uncompensated running sum loses low-order bits at every step
+  integer const     length = 257;
+  integer const     steps  = 20000000;
+  MovingAverage     filter(length);
+  std::vector<real> window(length, 0.0);
+  real              worst  = 0.0;
+  real              scale  = 0.0;
+  integer           checks = 0;
+  for (integer k = 0; k < steps; ++k)
+  {
+    real x = 1.0e6 + U(rng) * (k % 3 == 0 ? 1.0e5 : 1.0e-3);
+    real y = filter.setup(x, 1.0e-3);
+    window[k % length] = x;
+    scale = std::max(scale, std::abs(x));
+
+    // Direct mean of the window, summed in extended precision
+    if (k % 9973 == 0 || k == steps - 1)
+    {
+      long double sum = 0.0L;
+      integer     n   = std::min(k + 1, length);
+      for (integer i = 0; i < n; ++i)
+        sum += window[i];
+      worst = std::max(worst, real(std::abs(static_cast<long double>(y) - sum / n)));
+      ++checks;
+    }
+  }
+
+  // The error must stay at the round-off of a single step
+  real bound = 4.0 * EPSILON_MACHINE * scale;
+  std::printf("MovingAverage: max error %g over %d checks in %d steps (bound %g)\n", worst, checks, steps, bound);
+  return worst <= bound ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: MovingAverage.cc
+///
@@ -0,0 +1,136 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: PidBank.cc
+///
+
+// Bit exactness of the PIDBank lanes against the scalar PID block.
+// Build (the SIMD paths are selected by the target flags):
+//   g++ -std=c++20 -O2 -ffp-contract=off -I src tests/PidBank.cc
+//   g++ -std=c++20 -O2 -ffp-contract=off -mavx2 -I src tests/PidBank.cc
+//   g++ -std=c++20 -O2 -ffp-contract=off -mavx512f -I src tests/PidBank.cc
+
+#include "Piddle.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Piddle;
+
+int
+main(void)
+{
+  std::mt19937_64                      rng(42);
+  std::uniform_real_distribution<real> U(-1.0, 1.0);
+
+  // Lanes with mixed parameters and enabling states (the bank size is not a
+  // multiple of the vector width, so that the scalar tail is exercised too)
+  integer const    n = 1003;
+  std::vector<PID> pids;
+  for (integer i = 0; i < n; ++i)
+  {
+    PID pid(3.0 * U(rng), U(rng), 0.1 * U(rng), (i % 3) != 0 ? 50.0 * std::abs(U(rng)) : 0.0,
+            1.0 + 0.5 * U(rng), -1.0 - 0.5 * U(rng));
+    if (i % 7 == 0) pid.proportional().disable();
+    if (i % 11 == 0) pid.integral().disable();
+    if (i % 5 == 0) pid.derivative().disable();
+    if (i % 13 == 0) pid.antiwindup().disable();
+    if (i % 17 == 0) pid.disable();
+    pids.push_back(pid);
+  }
+  PIDBank bank;
+  for (PID const & pid : pids)
+    bank.push_back(pid);
+  std::vector<PID> ranged(pids);
+  PIDBank          gathered(bank);
+
+  // Step both with saturating errors, changing the time step halfway
+  std::vector<real> errors(n), out(n);
+  std::size_t       mismatches = 0;
+  std::size_t       samples    = 0;
+  for (integer k = 0; k < 2000; ++k)
+  {
+    real dt = k < 1000 ? 1.0e-3 : 2.0e-3;
+    for (real & e : errors)
+      e = 5.0 * U(rng);
+    bank.setup(errors, dt, out);
+    for (integer i = 0; i < n; ++i)
+    {
+      real u = pids[i].setup(errors[i], dt);
+      mismatches += std::memcmp(&u, &out[i], sizeof(real)) != 0;
+      ++samples;
+    }
+  }
+
+#if defined(__AVX512F__)
+  char const * path = "AVX-512";
+#elif defined(__AVX2__)
+  char const * path = "AVX2";
+#elif defined(__SSE2__)
+  char const * path = "SSE2";
+#else
+  char const * path = "scalar";
+#endif
+  std::printf("PIDBank %s kernel: %zu mismatches out of %zu samples\n", path, mismatches, samples);
+
+  // Step a copy in two lane ranges gathering the errors in reverse order,
+  // changing the time step and a cut-off frequency of the first range, so
+  // that the filter coefficients are updated range by range
+  std::vector<integer> sources(n);
+  for (integer i = 0; i < n; ++i)
+    sources[i] = n - 1 - i;
+  std::vector<real> values(n);
+  std::size_t       gather_mismatches = 0;
+  integer const     split             = 501;
+  for (integer k = 0; k < 2000; ++k)
+  {
+    real dt = k < 1000 ? 1.0e-3 : 2.0e-3;
+    if (k == 1500)
+    {
+      PIDParameters parameters = ranged[2].parameters();
+      parameters.fc            = 20.0;
+      ranged[2].parameters(parameters);
+      gathered.parameters(2, parameters);
+    }
+    for (real & v : values)
+      v = 5.0 * U(rng);
+    std::span<integer const> all(sources);
+    gathered.setup(0, values, all.first(split), {}, dt, std::span<real>(out).first(split));
+    gathered.setup(split, values, all.subspan(split), {}, dt, std::span<real>(out).subspan(split));
+    for (integer i = 0; i < n; ++i)
+    {
+      real u = ranged[i].setup(values[sources[i]], dt);
+      gather_mismatches += std::memcmp(&u, &out[i], sizeof(real)) != 0;
+    }
+  }
+  std::printf("PIDBank %s kernel, gathered ranges: %zu mismatches out of %zu samples\n", path, gather_mismatches, samples);
+  return mismatches == 0 && gather_mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: PidBank.cc
+///
@@ -0,0 +1,167 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: Telemetry.cc
+///
+
+// Round trip of pid step records through a telemetry channel, the drainer
+// binary file and the CSV conversion: every record must come back once, in
+// step order, with the values recorded by a reference probe.
+// Build:
+//   g++ -std=c++20 -O2 -pthread -I src tests/Telemetry.cc
+
+#include "Piddle.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Piddle;
+
+//! Telemetry probe appending the records to a vector (reference values)
+class VectorProbe
+{
+public:
+  static constexpr bool ENABLED = true; //!< Probe presence flag
+
+  std::vector<PIDRecord> * records = nullptr; //!< Recorded steps
+
+  //! Record a pid step
+  template <typename Scalar>
+  void
+  record(
+    Scalar        error,        //!< Input error value
+    Scalar        proportional, //!< Proportional term
+    Scalar        integral,     //!< Integral term
+    Scalar        derivative,   //!< Derivative term
+    Scalar        unsaturated,  //!< Output before saturation
+    Scalar        output,       //!< Output after saturation
+    std::uint32_t flags         //!< Clamp state flags
+  )
+  {
+    this->records->push_back(PIDRecord{0, 0, flags, error, proportional, integral, derivative, unsaturated, output});
+  }
+
+}; // class VectorProbe
+
+template <typename Probe>
+using ProbedPID = BasicPID<real, BasicProportional<real>, BasicIntegral<real>,
+                           BasicDerivative<real, BasicFilter<real>>, BasicAntiwindup<real>, Probe>;
+
+//! Build a probed pid controller whose output is clamped periodically
+template <typename Probe>
+static ProbedPID<Probe>
+make_pid(
+  Probe probe //!< Telemetry probe
+)
+{
+  return ProbedPID<Probe>(BasicProportional<real>(1.3), BasicIntegral<real>(0.7),
+                          BasicDerivative<real, BasicFilter<real>>(0.05, BasicFilter<real>(30.0)),
+                          BasicAntiwindup<real>(1.0, -1.0), std::move(probe));
+}
+
+int
+main(void)
+{
+  std::string path = (std::filesystem::temp_directory_path() / "piddle_telemetry_test.bin").string();
+
+  // Steps span several channel capacities, drained between batches so that
+  // no record is dropped
+  integer const                     steps   = 5 * PIDDLE_TELEMETRY_CAPACITY + 123;
+  std::uint32_t const               id      = 7;
+  std::shared_ptr<TelemetryChannel> channel = std::make_shared<TelemetryChannel>();
+  std::vector<PIDRecord>            expected;
+  VectorProbe                       reference;
+  reference.records = &expected;
+  ProbedPID<RingProbe>   probed = make_pid(RingProbe(channel, id));
+  ProbedPID<VectorProbe> mirror = make_pid(reference);
+  std::uint64_t          drained = 0;
+  {
+    TelemetryDrainer drainer(path);
+    drainer.add(channel);
+    for (integer k = 0; k < steps; ++k)
+    {
+      real error = 3.0 * std::sin(real(k) * 1.0e-2) + real(k) * 1.0e-6;
+      probed.setup(error, 1.0e-3);
+      mirror.setup(error, 1.0e-3);
+      if (k % 1000 == 999)
+        drainer.drain();
+    }
+    drainer.drain();
+    drained = drainer.records();
+  }
+
+  // Convert and parse the CSV back
+  std::ostringstream csv;
+  std::uint64_t      converted = telemetry_to_csv(path, csv);
+  std::filesystem::remove(path);
+  std::istringstream lines(csv.str());
+  std::string        line;
+  std::getline(lines, line);
+  std::size_t mismatches = 0;
+  std::size_t rows       = 0;
+  double      last_time  = 0.0;
+  bool        monotonic  = true;
+  while (std::getline(lines, line))
+  {
+    double       time, values[6];
+    unsigned     row_id, upper, lower, frozen;
+    int          fields = std::sscanf(line.c_str(), "%lf,%u,%lf,%lf,%lf,%lf,%lf,%lf,%u,%u,%u", &time, &row_id,
+                                      &values[0], &values[1], &values[2], &values[3], &values[4], &values[5],
+                                      &upper, &lower, &frozen);
+    if (fields != 11 || rows >= expected.size())
+    {
+      ++mismatches;
+      ++rows;
+      continue;
+    }
+    PIDRecord const & r     = expected[rows++];
+    std::uint32_t     flags = (upper ? PIDRecord::UPPER_CLAMP : 0) | (lower ? PIDRecord::LOWER_CLAMP : 0) |
+                              (frozen ? PIDRecord::FROZEN : 0);
+    mismatches += row_id != id || flags != r.flags || values[0] != r.error || values[1] != r.proportional ||
+                  values[2] != r.integral || values[3] != r.derivative || values[4] != r.unsaturated ||
+                  values[5] != r.output;
+    monotonic = monotonic && time >= last_time;
+    last_time = time;
+  }
+
+  std::size_t clamped = 0;
+  for (PIDRecord const & r : expected)
+    clamped += (r.flags & (PIDRecord::UPPER_CLAMP | PIDRecord::LOWER_CLAMP)) != 0;
+  std::printf("Telemetry: %d steps, %llu drained, %llu dropped, %llu converted, %zu rows (%zu clamped), "
+              "%zu mismatches, timestamps %s\n",
+              steps, static_cast<unsigned long long>(drained), static_cast<unsigned long long>(channel->dropped()),
+              static_cast<unsigned long long>(converted), rows, clamped, mismatches,
+              monotonic ? "monotonic" : "NOT monotonic");
+  bool ok = drained == std::uint64_t(steps) && channel->dropped() == 0 && converted == std::uint64_t(steps) &&
+            rows == std::size_t(steps) && mismatches == 0 && monotonic && clamped > 0;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Telemetry.cc
+///
@@ -0,0 +1,224 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+
+///
+/// file: Tuner.cc
+///
+
+// Concurrent stress test of the pid lock-free retuning channel: a writer
+// thread publishes parameter sets while the control loop steps the pid. The
+// control loop must only ever observe whole published sets, in publication
+// order, with the derivative filter enabled if and only if the cutoff
+// frequency is positive. The retune latency (from the publication to the
+// first control step using the set) is measured too, as well as the control
+// step duration histogram with an idle channel and with a writer thread
+// publishing as fast as it can (the histograms are reported, not checked,
+// since their tails depend on the machine and the scheduler).
+// Build:
+//   g++ -std=c++20 -O2 -pthread -I src tests/Tuner.cc
+// Usage: Tuner [parameter sets] [timed control steps]
+
+#include "Piddle.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace Piddle;
+
+//! Parameter set published with a given version (odd versions are filtered)
+static PIDParameters
+parameter_set(
+  std::uint64_t version //!< Parameter set version
+)
+{
+  real          k = real(version);
+  PIDParameters parameters;
+  parameters.kp    = k;
+  parameters.ki    = 0.5 * k;
+  parameters.kd    = 0.25 * k;
+  parameters.fc    = version % 2 == 1 ? 10.0 * k : 0.0;
+  parameters.upper = k;
+  parameters.lower = -k;
+  return parameters;
+}
+
+//! Current time in nanoseconds
+static std::int64_t
+now_ns(void)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Time every control step of a pid, in nanoseconds
+static std::vector<std::int64_t>
+step_durations(
+  PID &   pid,  //!< Pid block
+  integer steps //!< Number of control steps
+)
+{
+  std::vector<std::int64_t> durations(std::size_t(steps), 0);
+  for (integer k = 0; k < steps; ++k)
+  {
+    real         error = std::sin(real(k) * 1.0e-3);
+    std::int64_t start = now_ns();
+    pid.setup(error, 1.0e-4);
+    durations[k] = now_ns() - start;
+  }
+  std::sort(durations.begin(), durations.end());
+  return durations;
+}
+
+//! Print the percentiles and the power of two histogram of sorted durations
+static void
+print_durations(
+  char const *                      name,     //!< Case name
+  std::vector<std::int64_t> const & durations //!< Sorted durations (ns)
+)
+{
+  auto percentile = [&durations](real p) {
+    return static_cast<long long>(durations[std::size_t(p * real(durations.size() - 1))]);
+  };
+  std::printf("control step (ns), %s: median %lld, p99 %lld, p99.9 %lld, max %lld\n", name,
+              percentile(0.5), percentile(0.99), percentile(0.999), static_cast<long long>(durations.back()));
+  std::size_t  first = 0;
+  std::int64_t bound = 32;
+  while (first < durations.size())
+  {
+    std::size_t last = std::size_t(std::lower_bound(durations.begin() + first, durations.end(), bound) - durations.begin());
+    if (last > first)
+      std::printf("  < %8lld ns: %zu\n", static_cast<long long>(bound), last - first);
+    first  = last;
+    bound *= 2;
+  }
+}
+
+int
+main(int argc, char ** argv)
+{
+  std::uint64_t sets  = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  integer       timed = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+  PID pid(1.0, 0.0, 0.0, 0.0, 1.0, -1.0);
+  std::shared_ptr<PID::Tuner> tuner = std::make_shared<PID::Tuner>(pid.parameters());
+  pid.tuner(tuner);
+
+  integer failures = 0;
+
+  // Copies must be detached from the channel (a triple buffer has one reader)
+  PID copy(pid);
+  if (copy.tuner())
+  {
+    std::printf("FAILED: a pid copy shares the parameter channel\n");
+    ++failures;
+  }
+
+  // Publication times, written before each publication, so that they are
+  // visible to the control loop once it picks the set up
+  std::vector<std::int64_t> published(sets + 1, 0);
+  std::atomic<bool>         done{false};
+  std::uint64_t             bad_versions = 0;
+
+  std::thread writer([&]() {
+    for (std::uint64_t k = 1; k <= sets; ++k)
+    {
+      tuner->back() = parameter_set(k);
+      published[k]  = now_ns();
+      bad_versions += tuner->publish() != k;
+      // Publish at a bounded rate, as a tuning thread would
+      std::int64_t until = now_ns() + 200;
+      while (now_ns() < until) {}
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  // Control loop
+  std::vector<std::int64_t> latencies;
+  latencies.reserve(sets);
+  std::uint64_t steps = 0, last = 0, torn = 0, disorder = 0, filter = 0;
+  while (!done.load(std::memory_order_acquire) || tuner->is_dirty())
+  {
+    pid.setup(std::sin(real(steps) * 1.0e-3), 1.0e-4);
+    ++steps;
+    std::uint64_t version = tuner->version();
+    if (version == last)
+      continue;
+    latencies.push_back(now_ns() - published[version]);
+    disorder += version < last;
+    last = version;
+
+    PIDParameters expected = parameter_set(version);
+    PIDParameters actual   = pid.parameters();
+    torn += actual.kp != expected.kp || actual.ki != expected.ki || actual.kd != expected.kd ||
+            actual.fc != expected.fc || actual.upper != expected.upper || actual.lower != expected.lower;
+    filter += pid.derivative().filter().is_enabled() != (expected.fc > real(0.0));
+  }
+  writer.join();
+
+  if (last != sets || bad_versions != 0 || torn != 0 || disorder != 0 || filter != 0)
+  {
+    std::printf("FAILED: last version %llu of %llu, %llu bad versions, %llu torn sets, %llu out of order, "
+                "%llu wrong filter states\n",
+                static_cast<unsigned long long>(last), static_cast<unsigned long long>(sets),
+                static_cast<unsigned long long>(bad_versions), static_cast<unsigned long long>(torn),
+                static_cast<unsigned long long>(disorder), static_cast<unsigned long long>(filter));
+    ++failures;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](real p) {
+    return latencies[std::size_t(p * real(latencies.size() - 1))];
+  };
+  std::printf("%llu sets published, %zu picked up over %llu control steps\n",
+              static_cast<unsigned long long>(sets), latencies.size(), static_cast<unsigned long long>(steps));
+  std::printf("retune latency (ns): median %lld, p99 %lld, max %lld\n",
+              static_cast<long long>(percentile(0.5)), static_cast<long long>(percentile(0.99)),
+              static_cast<long long>(latencies.back()));
+
+  // Control step durations with an idle channel, then with a writer thread
+  // publishing back to back (every step may pick up a new set)
+  std::vector<std::int64_t> idle = step_durations(pid, timed);
+  std::atomic<bool>         stop{false};
+  std::thread hammer([&]() {
+    for (std::uint64_t k = sets + 1; !stop.load(std::memory_order_relaxed); ++k)
+    {
+      tuner->back() = parameter_set(k);
+      tuner->publish();
+    }
+  });
+  std::vector<std::int64_t> busy = step_durations(pid, timed);
+  stop.store(true, std::memory_order_relaxed);
+  hammer.join();
+  print_durations("idle channel", idle);
+  print_durations("concurrent publishing", busy);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///
+/// eof: Tuner.cc
+///
@@ -0,0 +1,77 @@
+/*
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ *                                                                     *
+ * The PIDDLE project                                                  *
+ *                                                                     *
+ * Copyright (c) 2020, Davide Stocco.                                  *
+ *                                                                     *
+ * The PIDDLE project and its components are supplied under the terms  *
+ * of the open source BSD 3-Clause License. The contents of the PIDDLE *
+ * project and its components may not be copied or disclosed except in *
+ * accordance with the terms of the BSD 3-Clause License.              *
+ *                                                                     *
+ * URL: https://opensource.org/licenses/BSD-3-Clause                   *
+ *                                                                     *
+ *    Davide Stocco                                                    *
+ *    Department of Industrial Engineering                             *
+ *    University of Trento                                             *
+ *    e-mail: davide.stocco@unitn.it                                   *
+ *                                                                     *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+*/
+
+///
+/// file: TelemetryCsv.cc
+///
+
+// Convert a telemetry binary file written by the TelemetryDrainer into CSV
+// (one row per pid step record, time in seconds from the first record).
+// Build:
+//   g++ -std=c++20 -O2 -I src tools/TelemetryCsv.cc -o telemetry_csv
+// Usage: telemetry_csv <telemetry file> [CSV file, standard output if omitted]
+
+#include "Piddle.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace Piddle;
+
+int
+main(int argc, char ** argv)
+{
+  if (argc < 2 || argc > 3)
+  {
+    std::fprintf(stderr, "usage: %s <telemetry file> [CSV file]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  try
+  {
+    std::uint64_t records = 0;
+    if (argc == 3)
+    {
+      std::ofstream csv(argv[2]);
+      if (!csv)
+      {
+        std::fprintf(stderr, "cannot open file '%s'\n", argv[2]);
+        return EXIT_FAILURE;
+      }
+      records = telemetry_to_csv(argv[1], csv);
+    }
+    else
+      records = telemetry_to_csv(argv[1], std::cout);
+    std::fprintf(stderr, "%llu records converted\n", static_cast<unsigned long long>(records));
+  }
+  catch (std::exception const & error)
+  {
+    std::fprintf(stderr, "%s\n", error.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+///
+/// eof: TelemetryCsv.cc
+///